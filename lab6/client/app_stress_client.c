@@ -19,6 +19,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "../common/constants.h"
+#include "../common/ipc.h"
+#include "../common/log.h"
+#include "../common/config.h"
 #include "../topology/topology.h"
 #include "srt_client.h"
 
@@ -32,31 +35,22 @@
 //#define WAITTIME 5
 #define WAITTIME 15
 
-//This function connects to the local SNP process on port NETWORK_PORT. If TCP connection fails, return -1. The TCP socket desciptor returned will be used by SRT to send segments.
+//This function connects to the local SNP process on port NETWORK_PORT (or the one set in the instance configuration). If TCP connection fails, return -1. The TCP socket desciptor returned will be used by SRT to send segments.
 int connectToNetwork() {
-	struct sockaddr_in servaddr;
-	
-	servaddr.sin_family = AF_INET;	
-	servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-	servaddr.sin_port = htons(NETWORK_PORT);
-
-	int network_conn = socket(AF_INET,SOCK_STREAM,0);  
-	if(network_conn<0)
-		return -1;
-	if(connect(network_conn, (struct sockaddr*)&servaddr, sizeof(servaddr))!=0) 
-		return -1;
-
-	//succefully connected
-	return network_conn;
+	return ipc_connect(config_getNetworkPort());
 }
 
 //This function disconnects from the local SNP process by closing the local TCP connection to the local SNP process. 
 void disconnectToNetwork(int network_conn) {
+	frame_release(network_conn);
 	close(network_conn);
 }
 
 
-int main() {
+int main(int argc, char *argv[]) {
+	log_init();
+	config_init(argc, argv);
+
 	//random seed for loss rate
 	srand(time(NULL));
 
@@ -18,6 +18,7 @@
 #include "../topology/topology.h"
 #include "srt_client.h"
 #include "../common/seg.h"
+#include "../common/log.h"
 
 //declare tcbtable as global variable
 client_tcb_t* tcbtable[MAX_TRANSPORT_CONNECTIONS];
@@ -163,7 +164,7 @@ int srt_client_connect(int sockfd, int nodeID, unsigned int server_port) {
 			syn.header.seq_num = 0;
 			syn.header.length = 0;
 			snp_sendseg(network_conn, clienttcb->svr_nodeID, &syn);	
-			printf("CLIENT: SYN SENT\n");
+			LOG_INFO("CLIENT: SYN SENT\n");
 	
 			//state transition
 			clienttcb->state = SYNSENT;
@@ -277,10 +278,10 @@ int srt_client_disconnect(int sockfd) {
 			fin.header.dest_port = clienttcb->svr_portNum;
 			fin.header.length = 0;
 			snp_sendseg(network_conn, clienttcb->svr_nodeID, &fin);
-			printf("CLIENT: FIN SENT\n");
+			LOG_INFO("CLIENT: FIN SENT\n");
 			//state transition
 			clienttcb->state = FINWAIT;
-			printf("CLIENT: FINWAIT\n");
+			LOG_INFO("CLIENT: FINWAIT\n");
 	
 			//resend in case of timeout
 			int retry = FIN_MAX_RETRY;
@@ -294,7 +295,7 @@ int srt_client_disconnect(int sockfd) {
 					return 1;
 				}
 				else {
-					printf("CLIENT: FIN RESENT\n");
+					LOG_INFO("CLIENT: FIN RESENT\n");
 					snp_sendseg(network_conn, clienttcb->svr_nodeID, &fin);
 					retry--;
 				}	
@@ -355,7 +356,7 @@ void* seghandler(void* arg) {
 		//find the tcb to handle the segment
 		client_tcb_t* my_clienttcb = tcbtable_gettcbFromPort(segBuf.header.dest_port);
 		if(!my_clienttcb) {
-			printf("CLIENT: NO PORT FOR RECEIVED SEGMENT\n");
+			LOG_WARN("CLIENT: NO PORT FOR RECEIVED SEGMENT\n");
 			continue;
 		}
 
@@ -365,12 +366,12 @@ void* seghandler(void* arg) {
 				break;
 			case SYNSENT:
 				if(segBuf.header.type==SYNACK&&my_clienttcb->svr_portNum==segBuf.header.src_port&&my_clienttcb->svr_nodeID==src_nodeID) {
-					printf("CLIENT: SYNACK RECEIVED\n");
+					LOG_INFO("CLIENT: SYNACK RECEIVED\n");
 					my_clienttcb->state = CONNECTED;
-					printf("CLIENT: CONNECTED\n");
+					LOG_INFO("CLIENT: CONNECTED\n");
 				}
 				else
-					printf("CLIENT: IN SYNSENT, NON SYNACK SEG RECEIVED\n");
+					LOG_WARN("CLIENT: IN SYNSENT, NON SYNACK SEG RECEIVED\n");
 				break;
 			case CONNECTED:	
 				if(segBuf.header.type==DATAACK&&my_clienttcb->svr_portNum==segBuf.header.src_port&&my_clienttcb->svr_nodeID==src_nodeID) {
@@ -382,17 +383,17 @@ void* seghandler(void* arg) {
 					}
 				}
 				else {
-					printf("CLIENT: IN CONNECTED, NON DATAACK SEG RECEIVED\n");
+					LOG_WARN("CLIENT: IN CONNECTED, NON DATAACK SEG RECEIVED\n");
 				}
 				break;
 			case FINWAIT:
 				if(segBuf.header.type==FINACK&&my_clienttcb->svr_portNum==segBuf.header.src_port&&my_clienttcb->svr_nodeID==src_nodeID) {
-					printf("CLIENT: FINACK RECEIVED\n");
+					LOG_INFO("CLIENT: FINACK RECEIVED\n");
 					my_clienttcb->state = CLOSED;
-					printf("CLIENT: CLOSED\n");
+					LOG_INFO("CLIENT: CLOSED\n");
 				}
 				else
-					printf("CLIENT: IN FINWAIT, NON FINACK SEG RECEIVED\n");
+					LOG_WARN("CLIENT: IN FINWAIT, NON FINACK SEG RECEIVED\n");
 				break;
 		}
 	}
@@ -426,6 +427,8 @@ void sendBuf_addSeg(client_tcb_t* clienttcb, segBuf_t* newSegBuf) {
 		if(clienttcb->sendBufunSent == 0)
 			clienttcb->sendBufunSent = newSegBuf;
 	}
+	//the segment doesn't change once it is in the send buffer, its checksum is computed once for all the times it is sent
+	newSegBuf->seg.header.checksum = checksum(&newSegBuf->seg);
 	pthread_mutex_unlock(clienttcb->bufMutex);
 }
 
@@ -434,24 +437,36 @@ void sendBuf_addSeg(client_tcb_t* clienttcb, segBuf_t* newSegBuf) {
 void sendBuf_send(client_tcb_t* clienttcb) {
 	pthread_mutex_lock(clienttcb->bufMutex);
 	
+	//collect the segments that fit in the window, they are sent with one call
+	segBuf_t* bufs[GBN_WINDOW];
+	seg_t* segs[GBN_WINDOW];
+	int segNum = 0;
+	//segBuf_timer should be started after sending out the first Data segment	
+	int startTimer = (clienttcb->unAck_segNum == 0);
 	while(clienttcb->unAck_segNum<GBN_WINDOW && clienttcb->sendBufunSent!=0) {
-		snp_sendseg(network_conn, clienttcb->svr_nodeID, (seg_t*)clienttcb->sendBufunSent);
-		struct timeval currentTime;
-		gettimeofday(&currentTime,NULL);
-		clienttcb->sendBufunSent->sentTime = currentTime.tv_sec*1000+ currentTime.tv_usec;
-		//segBuf_timer should be started after sending out the first Data segment	
-		if(clienttcb->unAck_segNum ==0) {
-			pthread_t timer;
-			pthread_create(&timer,NULL,sendBuf_timer, (void*)clienttcb);
-		}
+		bufs[segNum] = clienttcb->sendBufunSent;
+		segs[segNum] = (seg_t*)clienttcb->sendBufunSent;
+		segNum++;
 		clienttcb->unAck_segNum++;
-		
 
 		if(clienttcb->sendBufunSent != clienttcb->sendBufTail)
 			clienttcb->sendBufunSent= clienttcb->sendBufunSent->next;
 		else
 			clienttcb->sendBufunSent = 0; 
 	}
+
+	if(segNum>0) {
+		snp_sendseg_batch(network_conn, clienttcb->svr_nodeID, segs, segNum);
+		struct timeval currentTime;
+		gettimeofday(&currentTime,NULL);
+		int i;
+		for(i=0;i<segNum;i++)
+			bufs[i]->sentTime = currentTime.tv_sec*1000+ currentTime.tv_usec;
+		if(startTimer) {
+			pthread_t timer;
+			pthread_create(&timer,NULL,sendBuf_timer, (void*)clienttcb);
+		}
+	}
 	pthread_mutex_unlock(clienttcb->bufMutex);
 }
 
@@ -459,15 +474,22 @@ void sendBuf_send(client_tcb_t* clienttcb) {
 //resend all sent-but-unAcked segments in send buffer
 void sendBuf_timeout(client_tcb_t* clienttcb) {
 	pthread_mutex_lock(clienttcb->bufMutex);
+	//resend the whole window with one call
+	segBuf_t* bufs[GBN_WINDOW];
+	seg_t* segs[GBN_WINDOW];
 	segBuf_t* bufPtr=clienttcb->sendBufHead;
 	int i;
-	for(i=0;i<clienttcb->unAck_segNum;i++) {
-		snp_sendseg(network_conn, clienttcb->svr_nodeID, (seg_t*)bufPtr);
-		struct timeval currentTime;
-		gettimeofday(&currentTime,NULL);
-		bufPtr->sentTime = currentTime.tv_sec*1000000+ currentTime.tv_usec;
+	for(i=0;i<clienttcb->unAck_segNum && i<GBN_WINDOW;i++) {
+		bufs[i] = bufPtr;
+		segs[i] = (seg_t*)bufPtr;
 		bufPtr = bufPtr->next; 
 	}
+	int segNum = i;
+	snp_sendseg_batch(network_conn, clienttcb->svr_nodeID, segs, segNum);
+	struct timeval currentTime;
+	gettimeofday(&currentTime,NULL);
+	for(i=0;i<segNum;i++)
+		bufs[i]->sentTime = currentTime.tv_sec*1000000+ currentTime.tv_usec;
 	pthread_mutex_unlock(clienttcb->bufMutex);
 
 }
@@ -0,0 +1,179 @@
+//FILE: common/checksum.c
+//
+//Description: this file implements the Internet checksum used by the SRT segments
+//
+//Date: October 17, 2026
+
+#include <string.h>
+#include <stdint.h>
+
+#include "checksum.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHECKSUM_X86 1
+#include <immintrin.h>
+#endif
+
+//sum over len bytes, returns the unfolded sum
+typedef uint64_t (*checksum_add_fn)(const unsigned char* p, int len);
+
+//fold a 64-bit sum to 16 bits with end-around carries
+static unsigned short checksum_fold(uint64_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return (unsigned short)sum;
+}
+
+//portable loop: 32-bit words are added into a 64-bit accumulator, so no carry is lost
+//since 2^16 = 1 in ones' complement arithmetic, folding the sum of 32-bit words gives
+//the same result as adding the 16-bit words one by one
+static uint64_t checksum_add_words(const unsigned char* p, int len)
+{
+    uint64_t sum = 0;
+    uint32_t w[4];
+    while (len >= 16) {
+        memcpy(w, p, 16);
+        sum += (uint64_t)w[0] + w[1] + w[2] + w[3];
+        p += 16;
+        len -= 16;
+    }
+    while (len >= 4) {
+        memcpy(w, p, 4);
+        sum += w[0];
+        p += 4;
+        len -= 4;
+    }
+    if (len >= 2) {
+        uint16_t h;
+        memcpy(&h, p, 2);
+        sum += h;
+        p += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        // the odd octet is padded with a 0 octet after it
+        unsigned char last[2] = {*p, 0};
+        uint16_t h;
+        memcpy(&h, last, 2);
+        sum += h;
+    }
+    return sum;
+}
+
+#ifdef CHECKSUM_X86
+//max number of vector blocks added into the 32-bit lanes before they are added to the 64-bit sum,
+//each block adds at most 2 * 0xffff to a lane
+#define CHECKSUM_SIMD_BLOCKS 4096
+
+//SSE2 loop: the 16-bit words of each 16 byte block are widened to 32-bit lanes and added
+__attribute__((target("sse2")))
+static uint64_t checksum_add_sse2(const unsigned char* p, int len)
+{
+    uint64_t sum = 0;
+    __m128i zero = _mm_setzero_si128();
+    while (len >= 16) {
+        int blocks = len / 16;
+        if (blocks > CHECKSUM_SIMD_BLOCKS) {
+            blocks = CHECKSUM_SIMD_BLOCKS;
+        }
+        __m128i acc = zero;
+        for (int i = 0; i < blocks; i++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+            p += 16;
+        }
+        len -= blocks * 16;
+
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + checksum_add_words(p, len);
+}
+
+//AVX2 loop: same as the SSE2 loop with 32 byte blocks
+__attribute__((target("avx2")))
+static uint64_t checksum_add_avx2(const unsigned char* p, int len)
+{
+    uint64_t sum = 0;
+    __m256i zero = _mm256_setzero_si256();
+    while (len >= 32) {
+        int blocks = len / 32;
+        if (blocks > CHECKSUM_SIMD_BLOCKS) {
+            blocks = CHECKSUM_SIMD_BLOCKS;
+        }
+        __m256i acc = zero;
+        for (int i = 0; i < blocks; i++) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)p);
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+            p += 32;
+        }
+        len -= blocks * 32;
+
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for (int i = 0; i < 8; i++) {
+            sum += lanes[i];
+        }
+    }
+    return sum + checksum_add_words(p, len);
+}
+#endif
+
+//pick the fastest loop the CPU supports
+static checksum_add_fn checksum_select()
+{
+#ifdef CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return checksum_add_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return checksum_add_sse2;
+    }
+#endif
+    return checksum_add_words;
+}
+
+static checksum_add_fn checksum_add = NULL;
+
+//This function returns the 16-bit ones' complement sum of len bytes starting at data.
+//The 16-bit words are taken in host byte order. If len is odd, a 0 octet is added after the data.
+unsigned short checksum_sum(const void* data, int len)
+{
+    checksum_add_fn add = __atomic_load_n(&checksum_add, __ATOMIC_RELAXED);
+    if (add == NULL) {
+        add = checksum_select();
+        __atomic_store_n(&checksum_add, add, __ATOMIC_RELAXED);
+    }
+    return checksum_fold(add((const unsigned char*)data, len));
+}
+
+//This function returns the checksum of len bytes starting at data, which is the ones' complement of checksum_sum().
+//Data that carries a correct checksum field has checksum 0.
+unsigned short checksum_compute(const void* data, int len)
+{
+    return (unsigned short)~checksum_sum(data, len);
+}
+
+//This function returns the new checksum after a 16-bit word covered by checksum check is changed
+//from oldval to newval (RFC 1624, eqn. 3).
+unsigned short checksum_update16(unsigned short check, unsigned short oldval, unsigned short newval)
+{
+    uint64_t sum = (unsigned short)~check;
+    sum += (unsigned short)~oldval;
+    sum += newval;
+    return (unsigned short)~checksum_fold(sum);
+}
+
+//This function returns the new checksum after a 32-bit field covered by checksum check is changed
+//from oldval to newval. The field must start at an even offset.
+unsigned short checksum_update32(unsigned short check, unsigned int oldval, unsigned int newval)
+{
+    check = checksum_update16(check, oldval & 0xffff, newval & 0xffff);
+    return checksum_update16(check, oldval >> 16, newval >> 16);
+}
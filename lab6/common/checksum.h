@@ -0,0 +1,34 @@
+//FILE: common/checksum.h
+//
+//Description: this file defines the Internet checksum (RFC 1071) used by the SRT segments
+//
+//The sum is accumulated a word at a time in a 64-bit accumulator and folded to 16 bits only once
+//at the end. On x86 an AVX2 or SSE2 loop is chosen at run time when the CPU supports it, otherwise
+//a portable loop is used. All of them give the same result as summing one 16-bit word at a time
+//with an end-around carry on every step.
+//
+//The incremental update functions follow RFC 1624, so a checksum can be fixed up after a header
+//field is rewritten without summing the whole segment again (see seg_setacknum() in seg.c).
+//
+//Date: October 17, 2026
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+//This function returns the 16-bit ones' complement sum of len bytes starting at data.
+//The 16-bit words are taken in host byte order. If len is odd, a 0 octet is added after the data.
+unsigned short checksum_sum(const void* data, int len);
+
+//This function returns the checksum of len bytes starting at data, which is the ones' complement of checksum_sum().
+//Data that carries a correct checksum field has checksum 0.
+unsigned short checksum_compute(const void* data, int len);
+
+//This function returns the new checksum after a 16-bit word covered by checksum check is changed
+//from oldval to newval (RFC 1624, eqn. 3).
+unsigned short checksum_update16(unsigned short check, unsigned short oldval, unsigned short newval);
+
+//This function returns the new checksum after a 32-bit field covered by checksum check is changed
+//from oldval to newval. The field must start at an even offset.
+unsigned short checksum_update32(unsigned short check, unsigned int oldval, unsigned int newval);
+
+#endif
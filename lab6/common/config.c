@@ -0,0 +1,221 @@
+//FILE: common/config.c
+//
+//Description: this file implements the instance configuration of a DartNet node
+//
+//Date: October 17, 2026
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+static int config_nodeID = -1;
+static int config_overlayPort = -1;
+static int config_networkPort = -1;
+static int config_infinity = -1;
+static int config_routing = CONFIG_ROUTING_DV;
+static int config_detectTime = -1;
+static int config_queuePolicy = CONFIG_QUEUE_DROP;
+static char config_topologyFile[CONFIG_PATH_LEN] = "../topology/topology.dat";
+
+//parse a node ID or a port number, return -1 if it is not a number in [0, max]
+static int config_number(const char* str, int max)
+{
+    char* end;
+    long value = strtol(str, &end, 10);
+    if (*str == '\0' || *end != '\0' || value < 0 || value > max) {
+        return -1;
+    }
+    return (int)value;
+}
+
+//set one configuration value, return 1 if it is valid, otherwise return -1
+static int config_set(const char* key, const char* value)
+{
+    if (strcmp(key, "node") == 0) {
+        config_nodeID = config_number(value, BROADCAST_NODEID - 1);
+        return config_nodeID < 0 ? -1 : 1;
+    }
+    if (strcmp(key, "overlay_port") == 0) {
+        config_overlayPort = config_number(value, 65535);
+        return config_overlayPort < 0 ? -1 : 1;
+    }
+    if (strcmp(key, "network_port") == 0) {
+        config_networkPort = config_number(value, 65535);
+        return config_networkPort < 0 ? -1 : 1;
+    }
+    if (strcmp(key, "infinity") == 0) {
+        config_infinity = config_number(value, INFINITE_COST);
+        return config_infinity <= 0 ? -1 : 1;
+    }
+    if (strcmp(key, "routing") == 0) {
+        if (strcmp(value, "dv") == 0) {
+            config_routing = CONFIG_ROUTING_DV;
+        }
+        else if (strcmp(value, "ls") == 0) {
+            config_routing = CONFIG_ROUTING_LS;
+        }
+        else {
+            return -1;
+        }
+        return 1;
+    }
+    if (strcmp(key, "detect_time") == 0) {
+        config_detectTime = config_number(value, LINK_DETECT_MAX_TIME);
+        return config_detectTime < LINK_HEARTBEAT_MISSES ? -1 : 1;
+    }
+    if (strcmp(key, "queue_policy") == 0) {
+        if (strcmp(value, "drop") == 0) {
+            config_queuePolicy = CONFIG_QUEUE_DROP;
+        }
+        else if (strcmp(value, "block") == 0) {
+            config_queuePolicy = CONFIG_QUEUE_BLOCK;
+        }
+        else {
+            return -1;
+        }
+        return 1;
+    }
+    if (strcmp(key, "topology") == 0) {
+        if (strlen(value) >= CONFIG_PATH_LEN) {
+            return -1;
+        }
+        strcpy(config_topologyFile, value);
+        return 1;
+    }
+    return -1;
+}
+
+//read a config file, return 1 if it is read successfully, otherwise return -1
+static int config_read(const char* filename)
+{
+    FILE *fp;
+    if ((fp = fopen(filename, "r")) == NULL) {
+        printf("Cannot open config file %s!\n", filename);
+        return -1;
+    }
+
+    char line[CONFIG_PATH_LEN + 64];
+    int lineNum = 0;
+    int ret = 1;
+    while (fgets(line, sizeof(line), fp)) {
+        char key[64];
+        char value[CONFIG_PATH_LEN];
+        lineNum++;
+        if (line[0] == '#' || sscanf(line, "%63s", key) != 1) {
+            continue;
+        }
+        if (sscanf(line, "%63s %255s", key, value) != 2 || config_set(key, value) < 0) {
+            printf("%s:%d: bad config line\n", filename, lineNum);
+            ret = -1;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+static void config_usage(const char* prog)
+{
+    printf("usage: %s [-f config file] [-n node ID] [-t topology file] [-o overlay port] [-p network port] [-i infinity] [-r dv|ls] [-d detect time] [-q drop|block]\n", prog);
+    exit(1);
+}
+
+void config_init(int argc, char* argv[])
+{
+    char* env = getenv("DARTNET_CONFIG");
+    if (env != NULL && env[0] != '\0' && config_read(env) < 0) {
+        exit(1);
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:t:o:p:i:r:d:q:")) != -1) {
+        int ret;
+        switch (opt) {
+            case 'f':
+                ret = config_read(optarg);
+                break;
+            case 'n':
+                ret = config_set("node", optarg);
+                break;
+            case 't':
+                ret = config_set("topology", optarg);
+                break;
+            case 'o':
+                ret = config_set("overlay_port", optarg);
+                break;
+            case 'p':
+                ret = config_set("network_port", optarg);
+                break;
+            case 'i':
+                ret = config_set("infinity", optarg);
+                break;
+            case 'r':
+                ret = config_set("routing", optarg);
+                break;
+            case 'd':
+                ret = config_set("detect_time", optarg);
+                break;
+            case 'q':
+                ret = config_set("queue_policy", optarg);
+                break;
+            default:
+                ret = -1;
+                break;
+        }
+        if (ret < 0) {
+            config_usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        config_usage(argv[0]);
+    }
+}
+
+int config_getNodeID()
+{
+    return config_nodeID;
+}
+
+const char* config_getTopologyFile()
+{
+    return config_topologyFile;
+}
+
+int config_getOverlayPort()
+{
+    if (config_overlayPort >= 0) {
+        return config_overlayPort;
+    }
+    return config_nodeID < 0 ? OVERLAY_PORT : OVERLAY_PORT + config_nodeID;
+}
+
+int config_getNetworkPort()
+{
+    if (config_networkPort >= 0) {
+        return config_networkPort;
+    }
+    return config_nodeID < 0 ? NETWORK_PORT : NETWORK_PORT + config_nodeID;
+}
+
+unsigned int config_getInfinity()
+{
+    return config_infinity > 0 ? (unsigned int)config_infinity : ROUTE_INFINITY;
+}
+
+int config_getRouting()
+{
+    return config_routing;
+}
+
+unsigned int config_getDetectTime()
+{
+    return config_detectTime > 0 ? (unsigned int)config_detectTime : LINK_DETECT_TIME;
+}
+
+int config_getQueuePolicy()
+{
+    return config_queuePolicy;
+}
@@ -0,0 +1,79 @@
+//FILE: common/config.h
+//
+//Description: this file defines the instance configuration of a DartNet node
+//
+//By default a node takes its node ID from the IP address of the host it runs on and uses the
+//ports in constants.h, so only one node can run on a host. The instance configuration sets the
+//node ID, the topology file and the local ports, so that many nodes can run on one host.
+//The endpoints (host:port) of the other nodes are given in the topology file, see topology/topology.h.
+//
+//The configuration is read from a config file and from the command line options:
+//  -f <file>   read the config file <file>
+//  -n <id>     node ID of this instance
+//  -t <file>   topology file
+//  -o <port>   port the ON process listens on for the SNP process
+//  -p <port>   port the SNP process listens on for the SRT process
+//  -i <cost>   route cost at which a node is unreachable, see ROUTE_INFINITY in constants.h
+//  -r <mode>   routing mode of the SNP process, dv (distance vector, the default) or ls (link state)
+//  -d <ms>     time after which the ON process declares a silent neighbor link down, see LINK_DETECT_TIME in constants.h
+//  -q <policy> what the ON process does with a packet from the SNP process when the send queue to the neighbor is full,
+//              drop (drop the packet, the default) or block (wait for room, at most the detection time), see OVERLAY_SENDBUF_SIZE in constants.h
+//A config file has one "key value" pair per line, the keys are node, topology, overlay_port, network_port, infinity, routing,
+//detect_time and queue_policy.
+//Lines starting with '#' are comments. The environment variable DARTNET_CONFIG names a config file
+//that is read before the command line options.
+//
+//All the nodes of an overlay must use the same routing mode.
+//When a node ID is set and a port isn't, the port is the default port plus the node ID.
+//All the processes of a node (ON, SNP and SRT) must be given the same configuration.
+//
+//Date: October 17, 2026
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "constants.h"
+
+//max length of the topology file path
+#define CONFIG_PATH_LEN 256
+
+//routing modes
+#define CONFIG_ROUTING_DV 0	//distance vector, see network/dvtable.h
+#define CONFIG_ROUTING_LS 1	//link state, see network/lsdb.h
+
+//send queue policies
+//the policy only applies to the SNP data packets, the control packets never wait and use the end of the send buffer
+//reserved for them (see OVERLAY_SENDBUF_RESERVE)
+#define CONFIG_QUEUE_DROP 0	//a packet to a neighbor whose send queue is full is dropped, the other neighbors are not held up
+#define CONFIG_QUEUE_BLOCK 1	//the ON process waits for room in the send queue (backpressure to the SNP process)
+
+//This function reads the instance configuration from the environment variable DARTNET_CONFIG and the
+//command line options. It should be called at the start of main(), before any topology function is called.
+//The process exits with a usage message if an option is invalid.
+void config_init(int argc, char* argv[]);
+
+//This function returns the node ID set in the configuration, or -1 if it is not set.
+int config_getNodeID();
+
+//This function returns the path of the topology file.
+const char* config_getTopologyFile();
+
+//This function returns the port the ON process listens on for the SNP process.
+int config_getOverlayPort();
+
+//This function returns the port the SNP process listens on for the SRT process.
+int config_getNetworkPort();
+
+//This function returns the route cost at which a node is unreachable.
+unsigned int config_getInfinity();
+
+//This function returns the routing mode, CONFIG_ROUTING_DV or CONFIG_ROUTING_LS.
+int config_getRouting();
+
+//This function returns the link failure detection time in milliseconds.
+unsigned int config_getDetectTime();
+
+//This function returns the send queue policy, CONFIG_QUEUE_DROP or CONFIG_QUEUE_BLOCK.
+int config_getQueuePolicy();
+
+#endif
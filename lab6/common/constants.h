@@ -62,21 +62,133 @@
 //max packet data length
 #define MAX_PKT_LEN 1488 
 
+//the ON process sends a probe to each neighbor every LINK_DETECT_TIME / LINK_HEARTBEAT_MISSES milliseconds (heartbeat),
+//a link that has received nothing for LINK_DETECT_TIME milliseconds is declared down
+//the detection time can be set per instance, see common/config.h, up to LINK_DETECT_MAX_TIME milliseconds
+#define LINK_DETECT_TIME 600
+#define LINK_HEARTBEAT_MISSES 3
+#define LINK_DETECT_MAX_TIME 60000
+
+//the connection to a neighbor with a smaller node ID that is lost or was never made is made again by the probe thread:
+//the first attempt is made at once, an attempt fails if it isn't connected within the detection time, and after each failed
+//attempt the next one waits the detection time, doubled each time up to LINK_RETRY_MAX_TIME milliseconds
+#define LINK_RETRY_MAX_TIME 30000
+
+//the probes also measure the round trip time (RTT) of the links,
+//the cost of each link is evaluated every LINKCOST_INTERVAL milliseconds
+#define LINKCOST_INTERVAL 1000
+
+//the RTT and the throughput of a link are smoothed, each new sample has weight 1/LINKCOST_SMOOTHING
+#define LINKCOST_SMOOTHING 8
+
+//the measured cost of a link is its cost in the topology file plus an extra cost for its delay and its load:
+//1 for each LINKCOST_RTT_UNIT microseconds of smoothed RTT, plus up to LINKCOST_LOAD_EXTRA as the bytes sent per second
+//over the link go from LINKCOST_LOAD_KNEE percent to all of LINKCOST_LINK_CAPACITY (the load below the knee costs nothing,
+//so that the traffic of a link doesn't keep moving its routes back and forth)
+#define LINKCOST_RTT_UNIT 1000
+#define LINKCOST_LINK_CAPACITY 12500000
+#define LINKCOST_LOAD_KNEE 50
+#define LINKCOST_LOAD_EXTRA 4
+
+//the extra cost is at most LINKCOST_MAX_EXTRA and at most the cost of the link in the topology file, so a path costs at most
+//twice its cost in the topology and the measured costs don't make a node unreachable whose path is shorter than half the route infinity
+#define LINKCOST_MAX_EXTRA 8
+
+//a measured cost is reported to the SNP process only if it differs from the last reported cost by more than
+//LINKCOST_HYSTERESIS percent, so that small changes don't make the routes flap
+#define LINKCOST_HYSTERESIS 25
+
+//the neighbor connections are served by epoll reactor threads, one per CPU up to OVERLAY_MAX_REACTORS
+#define OVERLAY_MAX_REACTORS 4
+
+//a reactor hands at most OVERLAY_READ_BUDGET packets from one connection to the SNP process before it serves the others
+#define OVERLAY_READ_BUDGET 64
+
+//size in bytes of the send buffer of each neighbor connection
+//the packets to a neighbor wait in it until the connection can take them, when it is full the packets from the SNP process
+//are dropped or wait for room, see the queue policy in common/config.h
+#define OVERLAY_SENDBUF_SIZE 262144
+
+//bytes at the end of the send buffer that only the control packets (route updates, link states, probes) can take,
+//so that a full queue of SNP data packets never holds up or drops the routing packets
+#define OVERLAY_SENDBUF_RESERVE 32768
+
+//number of packets that can wait to be delivered to the SNP process, see overlay/pktqueue.h
+//it must be a power of two, a reactor stops reading from its neighbors while the queue is full
+#define OVERLAY_DELIVERY_SLOTS 1024
+
+//max number of packets delivered to the SNP process with one system call
+#define OVERLAY_DELIVERY_BATCH 64
+
+
+
+/*******************************************************************/
+//frame parameters
+/*******************************************************************/
+
+//frame mode used on all the TCP connections, see common/frame.h
+//0: length-prefixed frames
+//1: '!&' and '!#' delimited frames, only used to talk to the old SRT/SNP/ON processes
+#define FRAME_COMPAT_DELIMITER 0
+
+//size in bytes of each direction of a shared memory channel, see common/shmchan.h
+//it must be a power of two
+#define SHM_RING_SIZE 1048576
+
+//path of the Unix domain socket used instead of a local TCP port, see common/ipc.h
+//%d is replaced by the port number
+#define IPC_UNIX_PATH "/tmp/dartnet-%d.sock"
+
+
+
+/*******************************************************************/
+//logging parameters
+/*******************************************************************/
+
+//log messages above this level are compiled out, see common/log.h
+//it can also be set with -DLOG_COMPILE_LEVEL=... on the compiler command line
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 3
+#endif
+
+//log level used when the environment variable DARTNET_LOG is not set
+//0: error 1: warn 2: info 3: debug
+#define LOG_DEFAULT_LEVEL 2
+
+//number of messages each thread can have waiting for the log flusher thread
+//it must be a power of two, messages logged when the ring is full are dropped and counted
+#define LOG_RING_SLOTS 256
+
+//max length of a log message, longer messages are cut
+#define LOG_MSG_LEN 200
+
+//the log flusher thread writes out the waiting messages every LOG_FLUSH_INTERVAL milliseconds
+#define LOG_FLUSH_INTERVAL 20
+
 
 
 /*******************************************************************/
 //network layer parameters
 /*******************************************************************/
-//max node number support by the overlay  
-#define MAX_NODE_NUM 10
+//the node number is not limited, all the tables are sized from the topology at runtime
+//and a distance vector that doesn't fit in one packet is sent in several route update packets
 
-//max routing table slots 
-#define MAX_ROUTINGTABLE_SLOTS 10
+//number of routing table slots per node in the overlay
+#define ROUTINGTABLE_SLOTS_PER_NODE 2
+
+//max number of equal-cost next hops kept for a destination (equal-cost multipath)
+//the packets of a flow (source node, destination node and SRT ports) always take the same one of them, see network/fib.h
+#define ECMP_MAX_PATHS 4
 
 //infinite link cost value
 //if two nodes are unconnected, they will have link cost INFINITE_COST
 #define INFINITE_COST 999
 
+//a route whose cost reaches ROUTE_INFINITY is unreachable, it is advertised with cost INFINITE_COST
+//it bounds counting to infinity after a failure, so it should be just above the cost of the longest real path
+//it can be set per instance, see common/config.h
+#define ROUTE_INFINITY 256
+
 //network layer process opens this port, and waits for connection from transport layer process,
 //you should change this to a random value to avoid conflictions with other students
 //#define NETWORK_PORT 4022
@@ -86,5 +198,14 @@
 #define BROADCAST_NODEID 9999
 
 //route update broadcasting interval in seconds
+//while the routes are stable the interval doubles after each route update, up to ROUTEUPDATE_MAX_INTERVAL seconds
 #define ROUTEUPDATE_INTERVAL 5
+#define ROUTEUPDATE_MAX_INTERVAL 30
+
+//a triggered route update is sent ROUTEUPDATE_HOLDDOWN milliseconds after this node's distance vector changes,
+//so that a burst of changes goes out in one update
+#define ROUTEUPDATE_HOLDDOWN 5
+
+//min time between two route updates sent by a node in milliseconds
+#define ROUTEUPDATE_MIN_GAP 50
 #endif
@@ -0,0 +1,648 @@
+//FILE: common/frame.c
+//
+//Description: this file implements the frame layer used on all the TCP connections of DartNet
+//
+//Date: October 17, 2026
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "frame.h"
+#include "log.h"
+
+//frame layer state of a connection
+//bytes in buf[head, tail) are received but not handed out yet
+typedef struct frameconn {
+    char* buf;
+    int head;       //first byte not handed out yet
+    int tail;       //end of received bytes
+    int scan;       //delimiter mode only: position to continue searching '!#' from
+    pthread_mutex_t sendMutex;      //keeps frames sent by different threads from interleaving
+    int packet;                     //1 if the connection is message-oriented, one message is one frame
+    shm_chan_t* chan;               //shared memory channel carrying the frames, NULL for the TCP connection itself
+    int refs;                       //the table entry and each call using the state hold a reference, the last one frees it
+} frame_conn_t;
+
+//max number of iovecs passed to one writev() call
+#ifdef IOV_MAX
+#define FRAME_IOV_MAX IOV_MAX
+#else
+#define FRAME_IOV_MAX 1024
+#endif
+
+static int frame_mode = FRAME_COMPAT_DELIMITER ? FRAME_MODE_DELIMITER : FRAME_MODE_LENGTH;
+
+//per-thread scratch buffers used to build the iovecs, frame headers and messages of a batch
+//they grow to the largest batch sent by the thread and are reused, so sending doesn't allocate,
+//and they are freed when the thread exits
+typedef struct framescratch {
+    struct iovec* vec;
+    int vecSize;
+    unsigned char (*hdr)[FRAME_HDR_LEN];
+    int hdrSize;
+    struct mmsghdr* msgs;
+    int msgsSize;
+} frame_scratch_t;
+
+static pthread_once_t frame_scratch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t frame_scratch_key;
+static __thread frame_scratch_t* frame_myscratch = NULL;
+
+//called when a thread that has sent frames exits
+static void frame_freescratch(void* arg)
+{
+    frame_scratch_t* scratch = (frame_scratch_t*)arg;
+    free(scratch->vec);
+    free(scratch->hdr);
+    free(scratch->msgs);
+    free(scratch);
+}
+
+static void frame_scratchkey()
+{
+    pthread_key_create(&frame_scratch_key, frame_freescratch);
+}
+
+//get the scratch buffers of the calling thread
+static frame_scratch_t* frame_getscratch()
+{
+    if (frame_myscratch == NULL) {
+        pthread_once(&frame_scratch_once, frame_scratchkey);
+        frame_myscratch = (frame_scratch_t*)calloc(1, sizeof(frame_scratch_t));
+        pthread_setspecific(frame_scratch_key, frame_myscratch);
+    }
+    return frame_myscratch;
+}
+
+//make sure the scratch buffer *buf holds at least n items of the given size
+static void* frame_reserve(void* buf, int* size, int n, size_t itemSize)
+{
+    if (*size < n) {
+        *size = n < 64 ? 64 : n;
+        buf = realloc(buf, *size * itemSize);
+    }
+    return buf;
+}
+
+//frame layer state indexed by socket descriptor
+//the table is read locked to take a reference and write locked to change an entry
+static frame_conn_t* conns[FRAME_MAX_CONN];
+static pthread_rwlock_t conns_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+//get the frame layer state of a connection and take a reference to it, it must be given back with frame_put()
+//return NULL if conn has not been opened with frame_open() or it has been released
+static frame_conn_t* frame_get(int conn)
+{
+    if (conn < 0 || conn >= FRAME_MAX_CONN) {
+        return NULL;
+    }
+
+    pthread_rwlock_rdlock(&conns_lock);
+    frame_conn_t* fc = conns[conn];
+    if (fc != NULL) {
+        __atomic_fetch_add(&fc->refs, 1, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&conns_lock);
+    return fc;
+}
+
+//give back a reference taken with frame_get(), the state is freed with the last reference
+static void frame_put(frame_conn_t* fc)
+{
+    if (__atomic_sub_fetch(&fc->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        shmchan_close(fc->chan);
+        pthread_mutex_destroy(&fc->sendMutex);
+        free(fc->buf);
+        free(fc);
+    }
+}
+
+//remove the state fc of the connection conn from the table, if it is still there, and give back the reference of the table
+static void frame_unlink(int conn, frame_conn_t* fc)
+{
+    pthread_rwlock_wrlock(&conns_lock);
+    int linked = conns[conn] == fc;
+    if (linked) {
+        conns[conn] = NULL;
+    }
+    pthread_rwlock_unlock(&conns_lock);
+
+    if (linked) {
+        frame_put(fc);
+    }
+}
+
+//receive more bytes from the connection into the receive buffer, flags are passed to recv()
+//the unconsumed bytes are moved to the front of the buffer first if the free space at the end is used up
+//return the number of bytes received, FRAME_AGAIN if a non-blocking recv() finds no bytes,
+//or -1 if the connection is closed or the buffer is full
+static int frame_fill(int conn, frame_conn_t* reader, int flags)
+{
+    if (reader->head == reader->tail) {
+        reader->head = 0;
+        reader->tail = 0;
+        reader->scan = 0;
+    }
+    else if (reader->tail == FRAME_BUF_SIZE && reader->head > 0) {
+        int used = reader->tail - reader->head;
+        memmove(reader->buf, reader->buf + reader->head, used);
+        reader->scan -= reader->head;
+        reader->head = 0;
+        reader->tail = used;
+    }
+    if (reader->tail == FRAME_BUF_SIZE) {
+        return -1;
+    }
+
+    int n;
+    do {
+        n = recv(conn, reader->buf + reader->tail, FRAME_BUF_SIZE - reader->tail, flags);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return FRAME_AGAIN;
+    }
+    if (n <= 0) {
+        return -1;
+    }
+    reader->tail += n;
+    return n;
+}
+
+//hand out the frame body at buf[start, start+len) and consume the frame up to end
+//the body stays in the buffer until the next frame is looked for
+//return 1
+static int frame_deliver(frame_conn_t* reader, int start, int len, int end, void** body, int* bodylen)
+{
+    *body = reader->buf + start;
+    *bodylen = len;
+    reader->head = end;
+    reader->scan = reader->head;
+    return 1;
+}
+
+//find the next length-prefixed frame in the receive buffer
+//return 1 if a frame is handed out, 0 if more bytes are needed, -1 if the stream is corrupted
+static int frame_next_length(frame_conn_t* reader, void** body, int* bodylen)
+{
+    int avail = reader->tail - reader->head;
+    if (avail < FRAME_HDR_LEN) {
+        return 0;
+    }
+
+    unsigned char* hdr = (unsigned char*)reader->buf + reader->head;
+    if (hdr[0] != '!' || hdr[1] != '&') {
+        LOG_WARN("frame: bad frame header!\n");
+        return -1;
+    }
+    int len = (hdr[2] << 8) | hdr[3];
+    if (avail < FRAME_HDR_LEN + len) {
+        return 0;
+    }
+
+    int start = reader->head + FRAME_HDR_LEN;
+    return frame_deliver(reader, start, len, start + len, body, bodylen);
+}
+
+//find the next '!&' body '!#' frame in the receive buffer
+//bytes before the '!&' start delimiter are skipped as the old FSM did
+//return 1 if a frame is handed out, 0 if more bytes are needed
+static int frame_next_delimiter(frame_conn_t* reader, void** body, int* bodylen)
+{
+    char* buf = reader->buf;
+
+    // look for the start delimiter
+    while (reader->tail - reader->head >= 2 && !(buf[reader->head] == '!' && buf[reader->head + 1] == '&')) {
+        reader->head++;
+    }
+    if (reader->tail - reader->head < 2) {
+        return 0;
+    }
+
+    // look for the end delimiter
+    int start = reader->head + 2;
+    if (reader->scan < start) {
+        reader->scan = start;
+    }
+    while (reader->scan + 1 < reader->tail) {
+        if (buf[reader->scan] == '!' && buf[reader->scan + 1] == '#') {
+            return frame_deliver(reader, start, reader->scan - start, reader->scan + 2, body, bodylen);
+        }
+        reader->scan++;
+    }
+    return 0;
+}
+
+//find the next frame in the receive buffer in the frame mode of the process
+//return 1 if a frame is handed out, 0 if more bytes are needed, -1 if the stream is corrupted
+static int frame_next_buffered(frame_conn_t* reader, void** body, int* bodylen)
+{
+    if (frame_mode == FRAME_MODE_DELIMITER) {
+        return frame_next_delimiter(reader, body, bodylen);
+    }
+    return frame_next_length(reader, body, bodylen);
+}
+
+//This function sets the frame mode used by this process, FRAME_MODE_LENGTH or FRAME_MODE_DELIMITER.
+//All the processes in the overlay must use the same frame mode.
+void frame_setmode(int mode)
+{
+    frame_mode = mode;
+}
+
+//This function returns the frame mode used by this process.
+int frame_getmode()
+{
+    return frame_mode;
+}
+
+//write all the bytes in iov[0, iovcnt) to the connection
+//writev() is called again for the remaining bytes if it is interrupted or only writes part of them
+//return 1 if all the bytes are written, otherwise return -1
+static int frame_writeall(int conn, struct iovec* iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t n = writev(conn, iov, iovcnt < FRAME_IOV_MAX ? iovcnt : FRAME_IOV_MAX);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        // skip the written iovecs
+        while (iovcnt > 0 && n >= (ssize_t)iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 1;
+}
+
+//send frameNum frames as messages over a message-oriented connection, one message per frame
+//the messages are handed to the kernel with as few sendmmsg() calls as possible
+//return 1 if all the frames are sent, otherwise return -1
+static int frame_sendpackets(int conn, const struct iovec* iov, const int* iovcnt, int frameNum)
+{
+    frame_scratch_t* scratch = frame_getscratch();
+    scratch->msgs = frame_reserve(scratch->msgs, &scratch->msgsSize, frameNum, sizeof(struct mmsghdr));
+    struct mmsghdr* msgs = scratch->msgs;
+
+    const struct iovec* body = iov;
+    for (int i = 0; i < frameNum; i++) {
+        memset(&msgs[i], 0, sizeof(struct mmsghdr));
+        msgs[i].msg_hdr.msg_iov = (struct iovec*)body;
+        msgs[i].msg_hdr.msg_iovlen = iovcnt[i];
+        body += iovcnt[i];
+    }
+
+    int ret = 1;
+    int sent = 0;
+    while (sent < frameNum) {
+        int n = sendmmsg(conn, msgs + sent, frameNum - sent, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        sent += n;
+    }
+    return ret;
+}
+
+//This function sends a frame with the given body over the connection conn.
+//Return 1 if the frame is sent successfully, otherwise return -1.
+int frame_send(int conn, const void* body, int len)
+{
+    struct iovec iov;
+    int iovcnt = 1;
+    iov.iov_base = (void*)body;
+    iov.iov_len = len;
+    return frame_sendbatch(conn, &iov, &iovcnt, 1);
+}
+
+//This function sends frameNum frames over the connection conn with one writev() call.
+//The body of frame i is gathered from iovcnt[i] buffers, which are the next iovcnt[i] entries of iov.
+//Frames sent by different threads over the same connection are never interleaved.
+//Return 1 if all the frames are sent successfully, otherwise return -1.
+int frame_sendbatch(int conn, const struct iovec* iov, const int* iovcnt, int frameNum)
+{
+    frame_conn_t* fc = frame_get(conn);
+    if (fc == NULL) {
+        return -1;
+    }
+
+    if (fc->chan != NULL) {
+        pthread_mutex_lock(&fc->sendMutex);
+        int ret = shmchan_send(fc->chan, conn, iov, iovcnt, frameNum);
+        pthread_mutex_unlock(&fc->sendMutex);
+        frame_put(fc);
+        return ret;
+    }
+    if (fc->packet) {
+        pthread_mutex_lock(&fc->sendMutex);
+        int ret = frame_sendpackets(conn, iov, iovcnt, frameNum);
+        pthread_mutex_unlock(&fc->sendMutex);
+        frame_put(fc);
+        return ret;
+    }
+
+    // count the iovecs needed: a header and a trailer for each frame plus the bodies
+    int total = 0;
+    for (int i = 0; i < frameNum; i++) {
+        total += iovcnt[i] + 2;
+    }
+
+    frame_scratch_t* scratch = frame_getscratch();
+    scratch->vec = frame_reserve(scratch->vec, &scratch->vecSize, total, sizeof(struct iovec));
+    scratch->hdr = frame_reserve(scratch->hdr, &scratch->hdrSize, frameNum, FRAME_HDR_LEN);
+    struct iovec* vec = scratch->vec;
+    unsigned char (*hdr)[FRAME_HDR_LEN] = scratch->hdr;
+
+    int n = 0;
+    const struct iovec* body = iov;
+    for (int i = 0; i < frameNum; i++) {
+        size_t len = 0;
+        for (int j = 0; j < iovcnt[i]; j++) {
+            len += body[j].iov_len;
+        }
+        if (len > FRAME_MAX_LEN) {
+            n = -1;
+            break;
+        }
+
+        hdr[i][0] = '!';
+        hdr[i][1] = '&';
+        hdr[i][2] = (len >> 8) & 0xff;
+        hdr[i][3] = len & 0xff;
+        vec[n].iov_base = hdr[i];
+        vec[n].iov_len = frame_mode == FRAME_MODE_DELIMITER ? 2 : FRAME_HDR_LEN;
+        n++;
+        for (int j = 0; j < iovcnt[i]; j++) {
+            vec[n++] = body[j];
+        }
+        body += iovcnt[i];
+        if (frame_mode == FRAME_MODE_DELIMITER) {
+            vec[n].iov_base = "!#";
+            vec[n].iov_len = 2;
+            n++;
+        }
+    }
+
+    int ret = -1;
+    if (n >= 0) {
+        pthread_mutex_lock(&fc->sendMutex);
+        ret = frame_writeall(conn, vec, n);
+        pthread_mutex_unlock(&fc->sendMutex);
+    }
+    frame_put(fc);
+    return ret;
+}
+
+//receive the next frame from the connection conn whose state is reader, without copying it, as frame_next()
+//the connection is released if it is closed or the byte stream is corrupted
+//return the length of the frame body, or -1
+static int frame_take(int conn, frame_conn_t* reader, void** body)
+{
+    int len;
+    if (reader->chan != NULL) {
+        len = shmchan_next(reader->chan, conn, body);
+    }
+    else if (reader->packet) {
+        do {
+            len = recv(conn, reader->buf, FRAME_BUF_SIZE, 0);
+        } while (len < 0 && errno == EINTR);
+        if (len <= 0) {
+            len = -1;
+        }
+        *body = reader->buf;
+    }
+    else {
+        while (1) {
+            int ret = frame_next_buffered(reader, body, &len);
+            if (ret > 0) {
+                break;
+            }
+            if (ret < 0 || frame_fill(conn, reader, 0) < 0) {
+                len = -1;
+                break;
+            }
+        }
+    }
+    if (len < 0) {
+        frame_unlink(conn, reader);
+    }
+    return len;
+}
+
+//This function receives the next frame from the connection conn.
+//At most maxlen bytes of the frame body are copied into body, the rest of the body is discarded.
+//The receive buffer of the connection is filled with large recv() calls, so most frames
+//are handed out without a system call.
+//Return the length of the frame body if a frame is received successfully.
+//Return -1 if the connection is closed or the byte stream is corrupted.
+int frame_recv(int conn, void* body, int maxlen)
+{
+    frame_conn_t* reader = frame_get(conn);
+    if (reader == NULL) {
+        return -1;
+    }
+
+    if (reader->chan != NULL) {
+        int len = shmchan_recv(reader->chan, conn, body, maxlen);
+        if (len < 0) {
+            frame_unlink(conn, reader);
+        }
+        frame_put(reader);
+        return len;
+    }
+    if (reader->packet) {
+        // MSG_TRUNC makes recv() return the real message length even if it is cut to maxlen
+        int len;
+        do {
+            len = recv(conn, body, maxlen, MSG_TRUNC);
+        } while (len < 0 && errno == EINTR);
+        if (len <= 0) {
+            frame_unlink(conn, reader);
+            len = -1;
+        }
+        frame_put(reader);
+        return len;
+    }
+
+    void* frame;
+    int len = frame_take(conn, reader, &frame);
+    if (len >= 0) {
+        memcpy(body, frame, len < maxlen ? len : maxlen);
+    }
+    frame_put(reader);
+    return len;
+}
+
+//This function receives the next frame from the connection conn without copying it.
+//A pointer to the frame body is stored in body. The body stays in the receive buffer of the
+//connection (or in the shared memory ring) until the next frame_next() or frame_recv() call on conn,
+//so it can be decoded in place and copied straight to where it is needed.
+//Return the length of the frame body if a frame is received successfully.
+//Return -1 if the connection is closed or the byte stream is corrupted.
+int frame_next(int conn, void** body)
+{
+    frame_conn_t* reader = frame_get(conn);
+    if (reader == NULL) {
+        return -1;
+    }
+    int len = frame_take(conn, reader, body);
+    frame_put(reader);
+    return len;
+}
+
+//This function receives the next frame from the connection conn without waiting, it is used with event loops (epoll).
+//Return the length of the frame body if a frame is received, FRAME_AGAIN if no whole frame can be received yet,
+//or -1 if the connection is closed or the byte stream is corrupted.
+int frame_poll(int conn, void** body)
+{
+    frame_conn_t* reader = frame_get(conn);
+    if (reader == NULL) {
+        return -1;
+    }
+    if (reader->chan != NULL || reader->packet) {
+        int len = frame_take(conn, reader, body);
+        frame_put(reader);
+        return len;
+    }
+
+    // at most one recv() per call, so that a busy connection doesn't hold up the event loop
+    int len;
+    int ret = frame_next_buffered(reader, body, &len);
+    if (ret == 0) {
+        int n = frame_fill(conn, reader, MSG_DONTWAIT);
+        ret = n == FRAME_AGAIN ? 0 : n < 0 ? -1 : frame_next_buffered(reader, body, &len);
+    }
+    if (ret == 0) {
+        len = FRAME_AGAIN;
+    }
+    else if (ret < 0) {
+        frame_unlink(conn, reader);
+        len = -1;
+    }
+    frame_put(reader);
+    return len;
+}
+
+//This function builds the frame with the given body in buf, so that it can be written out later, a part at a time.
+//Return the length of the frame, or -1 if the frame doesn't fit in size bytes.
+int frame_pack(void* buf, int size, const void* body, int len)
+{
+    int hdrlen = frame_mode == FRAME_MODE_DELIMITER ? 2 : FRAME_HDR_LEN;
+    int trailerlen = frame_mode == FRAME_MODE_DELIMITER ? 2 : 0;
+    if (len > FRAME_MAX_LEN || hdrlen + len + trailerlen > size) {
+        return -1;
+    }
+
+    unsigned char* p = (unsigned char*)buf;
+    p[0] = '!';
+    p[1] = '&';
+    if (frame_mode != FRAME_MODE_DELIMITER) {
+        p[2] = (len >> 8) & 0xff;
+        p[3] = len & 0xff;
+    }
+    memcpy(p + hdrlen, body, len);
+    if (trailerlen > 0) {
+        memcpy(p + hdrlen + len, "!#", 2);
+    }
+    return hdrlen + len + trailerlen;
+}
+
+//This function marks the connection conn as message-oriented (SOCK_SEQPACKET).
+//From now on each frame of conn is sent as one message, and each message received is one frame.
+//An empty message can't be told apart from the end of the connection, so empty frames must not be sent.
+void frame_setpacket(int conn)
+{
+    frame_conn_t* fc = frame_get(conn);
+    if (fc != NULL) {
+        fc->packet = 1;
+        frame_put(fc);
+    }
+}
+
+//This function attaches a shared memory channel to the connection conn.
+//From now on the frames of conn are sent and received over the channel instead of the TCP connection.
+//The channel is closed when the connection is released.
+void frame_attach(int conn, shm_chan_t* chan)
+{
+    frame_conn_t* fc = frame_get(conn);
+    if (fc != NULL) {
+        fc->chan = chan;
+        frame_put(fc);
+    }
+    else {
+        shmchan_close(chan);
+    }
+}
+
+//This function sets up the frame layer state of the new connection conn.
+//It must be called before any frame is sent or received on conn.
+//Return 1 if it succeeds, otherwise return -1.
+int frame_open(int conn)
+{
+    if (conn < 0 || conn >= FRAME_MAX_CONN) {
+        return -1;
+    }
+
+    frame_conn_t* fc = (frame_conn_t*)malloc(sizeof(frame_conn_t));
+    fc->buf = (char*)malloc(FRAME_BUF_SIZE);
+    fc->head = 0;
+    fc->tail = 0;
+    fc->scan = 0;
+    pthread_mutex_init(&fc->sendMutex, NULL);
+    fc->packet = 0;
+    fc->chan = NULL;
+    fc->refs = 1;
+
+    pthread_rwlock_wrlock(&conns_lock);
+    frame_conn_t* old = conns[conn];
+    conns[conn] = fc;
+    pthread_rwlock_unlock(&conns_lock);
+
+    // state left by a connection that was closed without being released
+    if (old != NULL) {
+        frame_put(old);
+    }
+    return 1;
+}
+
+//This function releases the frame layer state of the connection conn: its receive buffer is freed
+//and the shared memory channel attached to conn, if any, is closed.
+//It should be called before conn is closed, so that buffered bytes of this connection
+//are not handed out on a new connection reusing the same socket descriptor.
+//The calls other threads are making on conn finish first, the state is freed when the last of them returns,
+//and all the later calls on conn fail until it is opened again.
+void frame_release(int conn)
+{
+    if (conn < 0 || conn >= FRAME_MAX_CONN) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&conns_lock);
+    frame_conn_t* fc = conns[conn];
+    conns[conn] = NULL;
+    pthread_rwlock_unlock(&conns_lock);
+
+    if (fc != NULL) {
+        frame_put(fc);
+    }
+}
@@ -0,0 +1,115 @@
+//FILE: common/frame.h
+//
+//Description: this file defines the frame layer used on all the TCP connections of DartNet
+//(SRT process <-> SNP process, SNP process <-> ON process and ON process <-> ON process).
+//
+//A frame is a 4 byte frame header followed by the frame body:
+//  '!' '&' length(2 bytes, network byte order) body
+//The receiver reads the connection with large recv() calls into a per-connection buffer
+//and hands out one whole frame per call, instead of reading the stream one byte at a time.
+//
+//The old '!&' body '!#' delimited framing is still supported as a compatibility mode,
+//see FRAME_COMPAT_DELIMITER in constants.h.
+//
+//On a message-oriented connection (SOCK_SEQPACKET, see frame_setpacket()) each frame is
+//sent as one message without a header, the socket keeps the frame boundaries.
+//
+//The frame layer state of a connection is set up with frame_open() when the connection is made
+//and taken down with frame_release(). Each call on the connection holds a reference to the state,
+//so a connection released by one thread is freed only after the calls of the other threads return.
+//
+//Date: October 17, 2026
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <sys/uio.h>
+#include "constants.h"
+#include "shmchan.h"
+
+//frame modes
+#define FRAME_MODE_LENGTH 0	//length-prefixed frames
+#define FRAME_MODE_DELIMITER 1	//'!&' body '!#' frames, used by the old SRT/SNP/ON processes
+
+//length of the frame header
+#define FRAME_HDR_LEN 4
+//max length of a frame body, the length field in the frame header is 16 bits
+#define FRAME_MAX_LEN 65535
+//size of the per-connection receive buffer
+#define FRAME_BUF_SIZE 131072
+//max socket descriptor that can be used with the frame layer
+#define FRAME_MAX_CONN 1024
+//returned by frame_poll() when no whole frame can be received without waiting
+#define FRAME_AGAIN -2
+
+//This function sets the frame mode used by this process, FRAME_MODE_LENGTH or FRAME_MODE_DELIMITER.
+//All the processes in the overlay must use the same frame mode.
+void frame_setmode(int mode);
+
+//This function returns the frame mode used by this process.
+int frame_getmode();
+
+//This function sends a frame with the given body over the connection conn.
+//The frame header, the body and the trailer (delimiter mode only) are written with one writev() call.
+//Return 1 if the frame is sent successfully, otherwise return -1.
+int frame_send(int conn, const void* body, int len);
+
+//This function sends frameNum frames over the connection conn with one writev() call.
+//The body of frame i is gathered from iovcnt[i] buffers, which are the next iovcnt[i] entries of iov.
+//Frames sent by different threads over the same connection are never interleaved.
+//Return 1 if all the frames are sent successfully, otherwise return -1.
+int frame_sendbatch(int conn, const struct iovec* iov, const int* iovcnt, int frameNum);
+
+//This function receives the next frame from the connection conn.
+//At most maxlen bytes of the frame body are copied into body, the rest of the body is discarded.
+//The receive buffer of the connection is filled with large recv() calls, so most frames
+//are handed out without a system call.
+//Return the length of the frame body if a frame is received successfully.
+//Return -1 if the connection is closed or the byte stream is corrupted.
+int frame_recv(int conn, void* body, int maxlen);
+
+//This function receives the next frame from the connection conn without waiting, it is used with event loops (epoll).
+//If no whole frame is in the receive buffer, the bytes the socket holds are read once without blocking.
+//The frame is handed out in place as with frame_next().
+//Return the length of the frame body if a frame is received, FRAME_AGAIN if no whole frame can be received yet
+//(wait until the socket is readable), or -1 if the connection is closed or the byte stream is corrupted.
+//It is only used on byte stream connections, on the other connections it waits as frame_next().
+int frame_poll(int conn, void** body);
+
+//This function builds the frame with the given body in buf, so that it can be written out later, a part at a time.
+//It is used with non-blocking byte stream connections, whose frames are written from a send buffer.
+//Return the length of the frame, or -1 if the frame doesn't fit in size bytes.
+int frame_pack(void* buf, int size, const void* body, int len);
+
+//This function marks the connection conn as message-oriented (SOCK_SEQPACKET).
+//From now on each frame of conn is sent as one message, and each message received is one frame.
+//An empty message can't be told apart from the end of the connection, so empty frames must not be sent.
+void frame_setpacket(int conn);
+
+//This function attaches a shared memory channel to the connection conn.
+//From now on the frames of conn are sent and received over the channel instead of the TCP connection.
+//The channel is closed when the connection is released.
+void frame_attach(int conn, shm_chan_t* chan);
+
+//This function receives the next frame from the connection conn without copying it.
+//A pointer to the frame body is stored in body. The body stays in the receive buffer of the
+//connection (or in the shared memory ring) until the next frame_next() or frame_recv() call on conn
+//or until conn is released, so it can be decoded in place and copied straight to where it is needed.
+//Return the length of the frame body if a frame is received successfully.
+//Return -1 if the connection is closed or the byte stream is corrupted.
+int frame_next(int conn, void** body);
+
+//This function sets up the frame layer state of the new connection conn.
+//It must be called before any frame is sent or received on conn.
+//Return 1 if it succeeds, otherwise return -1.
+int frame_open(int conn);
+
+//This function releases the frame layer state of the connection conn: its receive buffer is freed
+//and the shared memory channel attached to conn, if any, is closed.
+//It should be called before conn is closed, so that buffered bytes of this connection
+//are not handed out on a new connection reusing the same socket descriptor.
+//The calls other threads are making on conn finish first, the state is freed when the last of them returns,
+//and all the later calls on conn fail until it is opened again.
+void frame_release(int conn);
+
+#endif
@@ -0,0 +1,228 @@
+//FILE: common/ipc.c
+//
+//Description: this file implements the local connections between the processes on the same node
+//
+//Date: October 17, 2026
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/un.h>
+
+#include "ipc.h"
+#include "frame.h"
+#include "shmchan.h"
+#include "log.h"
+
+//message sent by the connecting side in shared memory mode, followed by the channel name
+#define IPC_SHM_HELLO "SHM "
+//reply of the accepting side once it has opened the channel
+#define IPC_SHM_ACK "OK"
+
+static int ipc_mode = -1;
+
+//This function sets the local connection mode used by this process, one of the IPC_MODE_ values.
+//It overrides the environment variable DARTNET_IPC.
+void ipc_setmode(int mode)
+{
+    ipc_mode = mode;
+}
+
+//This function returns the local connection mode used by this process.
+int ipc_getmode()
+{
+    if (ipc_mode < 0) {
+        char* env = getenv("DARTNET_IPC");
+        if (env != NULL && strcmp(env, "shm") == 0) {
+            ipc_mode = IPC_MODE_SHM;
+        }
+        else if (env != NULL && strcmp(env, "unix") == 0) {
+            ipc_mode = IPC_MODE_UNIX;
+        }
+        else if (env != NULL && strcmp(env, "seqpacket") == 0) {
+            ipc_mode = IPC_MODE_SEQPACKET;
+        }
+        else {
+            ipc_mode = IPC_MODE_TCP;
+        }
+    }
+    return ipc_mode;
+}
+
+//connecting side of the shared memory handshake
+//return 1 if the channel is attached to conn, otherwise return -1
+static int ipc_shm_connect(int conn)
+{
+    char name[SHMCHAN_NAME_LEN];
+    shm_chan_t* chan = shmchan_create(name);
+    if (chan == NULL) {
+        return -1;
+    }
+
+    char msg[sizeof(IPC_SHM_HELLO) + SHMCHAN_NAME_LEN];
+    snprintf(msg, sizeof(msg), "%s%s", IPC_SHM_HELLO, name);
+    char ack[sizeof(IPC_SHM_ACK)];
+    int len;
+    if (frame_send(conn, msg, strlen(msg)) < 0
+        || (len = frame_recv(conn, ack, sizeof(ack))) != strlen(IPC_SHM_ACK)
+        || memcmp(ack, IPC_SHM_ACK, len) != 0) {
+        LOG_ERROR("ipc: shared memory handshake failed!\n");
+        shmchan_close(chan);
+        return -1;
+    }
+
+    frame_attach(conn, chan);
+    return 1;
+}
+
+//accepting side of the shared memory handshake
+//return 1 if the channel is attached to conn, otherwise return -1
+static int ipc_shm_accept(int conn)
+{
+    char msg[sizeof(IPC_SHM_HELLO) + SHMCHAN_NAME_LEN];
+    int len = frame_recv(conn, msg, sizeof(msg) - 1);
+    if (len < (int)strlen(IPC_SHM_HELLO) || len >= (int)sizeof(msg)
+        || memcmp(msg, IPC_SHM_HELLO, strlen(IPC_SHM_HELLO)) != 0) {
+        LOG_WARN("ipc: bad shared memory handshake!\n");
+        return -1;
+    }
+    msg[len] = '\0';
+
+    shm_chan_t* chan = shmchan_open(msg + strlen(IPC_SHM_HELLO));
+    if (chan == NULL) {
+        return -1;
+    }
+    if (frame_send(conn, IPC_SHM_ACK, strlen(IPC_SHM_ACK)) < 0) {
+        shmchan_close(chan);
+        return -1;
+    }
+
+    frame_attach(conn, chan);
+    return 1;
+}
+
+//build the address of the local port in the current mode
+//return the socket type to use with it
+static int ipc_addr(int port, struct sockaddr_storage* addr, socklen_t* addrlen)
+{
+    memset(addr, 0, sizeof(struct sockaddr_storage));
+    int mode = ipc_getmode();
+    if (mode == IPC_MODE_UNIX || mode == IPC_MODE_SEQPACKET) {
+        struct sockaddr_un* un = (struct sockaddr_un*)addr;
+        un->sun_family = AF_UNIX;
+        snprintf(un->sun_path, sizeof(un->sun_path), IPC_UNIX_PATH, port);
+        *addrlen = sizeof(struct sockaddr_un);
+        return mode == IPC_MODE_SEQPACKET ? SOCK_SEQPACKET : SOCK_STREAM;
+    }
+
+    struct sockaddr_in* in = (struct sockaddr_in*)addr;
+    in->sin_family = AF_INET;
+    in->sin_addr.s_addr = htonl(INADDR_ANY);
+    in->sin_port = htons(port);
+    *addrlen = sizeof(struct sockaddr_in);
+    return SOCK_STREAM;
+}
+
+//This function connects to the local process listening on the given port.
+//In shared memory mode the shared memory channel is set up before it returns.
+//Return the connection if it succeeds, otherwise return -1.
+int ipc_connect(int port)
+{
+    struct sockaddr_storage servaddr;
+    socklen_t addrlen;
+    int type = ipc_addr(port, &servaddr, &addrlen);
+
+    int conn = socket(servaddr.ss_family, type, 0);
+    if (conn < 0) {
+        perror("ipc: socket creation error");
+        return -1;
+    }
+    if (connect(conn, (struct sockaddr*)&servaddr, addrlen) != 0) {
+        perror("ipc: connect error");
+        close(conn);
+        return -1;
+    }
+    frame_open(conn);
+
+    if (type == SOCK_SEQPACKET) {
+        frame_setpacket(conn);
+    }
+    if (ipc_getmode() == IPC_MODE_SHM && ipc_shm_connect(conn) < 0) {
+        frame_release(conn);
+        close(conn);
+        return -1;
+    }
+    return conn;
+}
+
+//This function opens the given port for local connections.
+//Return the listening socket if it succeeds, otherwise return -1.
+int ipc_listen(int port)
+{
+    struct sockaddr_storage server_addr;
+    socklen_t addrlen;
+    int type = ipc_addr(port, &server_addr, &addrlen);
+
+    int sockfd = socket(server_addr.ss_family, type, 0);
+    if (sockfd < 0) {
+        perror("ipc: socket creation error");
+        return -1;
+    }
+
+    if (server_addr.ss_family == AF_UNIX) {
+        // a socket file left by a process that is gone is removed, a live one is not taken over
+        const char* path = ((struct sockaddr_un*)&server_addr)->sun_path;
+        int probe = socket(AF_UNIX, type, 0);
+        if (probe >= 0 && connect(probe, (struct sockaddr*)&server_addr, addrlen) == 0) {
+            LOG_ERROR("ipc: %s is in use!\n", path);
+            close(probe);
+            close(sockfd);
+            return -1;
+        }
+        if (probe >= 0) {
+            close(probe);
+        }
+        unlink(path);
+    }
+
+    if (bind(sockfd, (struct sockaddr*)&server_addr, addrlen) < 0) {
+        perror("ipc: bind error");
+        close(sockfd);
+        return -1;
+    }
+    if (listen(sockfd, 1) < 0) {
+        perror("ipc: listen error");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+//This function waits for the next local connection on the listening socket listenfd.
+//In shared memory mode the shared memory channel is set up before it returns, a connection
+//on which the channel can't be set up is closed and the next one is waited for.
+//Return the connection if it succeeds, otherwise return -1.
+int ipc_accept(int listenfd)
+{
+    while (1) {
+        int conn = accept(listenfd, NULL, NULL);
+        if (conn < 0) {
+            perror("ipc: accept error");
+            return -1;
+        }
+        frame_open(conn);
+        if (ipc_getmode() == IPC_MODE_SEQPACKET) {
+            frame_setpacket(conn);
+        }
+        if (ipc_getmode() != IPC_MODE_SHM || ipc_shm_accept(conn) > 0) {
+            return conn;
+        }
+        frame_release(conn);
+        close(conn);
+    }
+}
@@ -0,0 +1,53 @@
+//FILE: common/ipc.h
+//
+//Description: this file defines the local connections between the processes on the same node
+//(SRT process <-> SNP process and SNP process <-> ON process).
+//
+//A local connection is a TCP connection to localhost, or a Unix domain socket (stream or seqpacket)
+//whose path is made from the port number (see IPC_UNIX_PATH in constants.h). Unix domain sockets
+//skip the TCP/IP stack and several stacks can run on one host as long as their ports differ.
+//On a seqpacket socket each frame is one message, so no frame header or delimiter is needed.
+//
+//In shared memory mode the local connection starts as a TCP connection. The connecting side then
+//creates a shared memory channel (see common/shmchan.h) and sends its name over the TCP connection,
+//the accepting side opens it and acknowledges, and from then on all the frames of the connection
+//go through the channel. The TCP connection stays open so that each side
+//notices when the other process is gone.
+//
+//The mode is taken from the environment variable DARTNET_IPC: "tcp" (default), "unix", "seqpacket" or "shm".
+//Both ends of a local connection must use the same mode.
+//
+//Date: October 17, 2026
+
+#ifndef IPC_H
+#define IPC_H
+
+//local connection modes
+#define IPC_MODE_TCP 0
+#define IPC_MODE_SHM 1
+#define IPC_MODE_UNIX 2         //AF_UNIX SOCK_STREAM
+#define IPC_MODE_SEQPACKET 3    //AF_UNIX SOCK_SEQPACKET
+
+//This function sets the local connection mode used by this process, one of the IPC_MODE_ values.
+//It overrides the environment variable DARTNET_IPC.
+void ipc_setmode(int mode);
+
+//This function returns the local connection mode used by this process.
+int ipc_getmode();
+
+//This function connects to the local process listening on the given port.
+//In shared memory mode the shared memory channel is set up before it returns.
+//Return the connection if it succeeds, otherwise return -1.
+int ipc_connect(int port);
+
+//This function opens the given port for local connections.
+//Return the listening socket if it succeeds, otherwise return -1.
+int ipc_listen(int port);
+
+//This function waits for the next local connection on the listening socket listenfd.
+//In shared memory mode the shared memory channel is set up before it returns, a connection
+//on which the channel can't be set up is closed and the next one is waited for.
+//Return the connection if it succeeds, otherwise return -1.
+int ipc_accept(int listenfd);
+
+#endif
@@ -0,0 +1,180 @@
+//FILE: common/log.c
+//
+//Description: this file implements the logging facility used by all the DartNet processes
+//
+//Date: October 17, 2026
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "log.h"
+
+//a log message waiting in a ring
+typedef struct logmsg {
+    int len;
+    char text[LOG_MSG_LEN];
+} log_msg_t;
+
+//per-thread ring of log messages
+//tail is only written by the owner thread and head is only written by the flusher
+typedef struct logring {
+    unsigned int tail;          //messages written by the owner thread
+    unsigned int head;          //messages written out by the flusher
+    unsigned int dropped;       //messages dropped because the ring was full
+    int dead;                   //set when the owner thread exits, the ring is freed once it is drained
+    struct logring* next;
+    log_msg_t msgs[LOG_RING_SLOTS];
+} log_ring_t;
+
+int log_level = LOG_DEFAULT_LEVEL;
+
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t log_key;
+//protects the list of rings and makes sure only one thread drains the rings at a time
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t* log_rings = NULL;
+static __thread log_ring_t* log_myring = NULL;
+
+//called when a thread that has logged exits
+static void log_threadexit(void* arg)
+{
+    log_ring_t* ring = (log_ring_t*)arg;
+    __atomic_store_n(&ring->dead, 1, __ATOMIC_RELEASE);
+}
+
+//the log flusher thread
+static void* log_flusher(void* arg)
+{
+    struct timespec interval;
+    interval.tv_sec = LOG_FLUSH_INTERVAL / 1000;
+    interval.tv_nsec = (LOG_FLUSH_INTERVAL % 1000) * 1000000L;
+    while (1) {
+        nanosleep(&interval, NULL);
+        log_flush();
+    }
+    return NULL;
+}
+
+static void log_start()
+{
+    char* env = getenv("DARTNET_LOG");
+    if (env != NULL) {
+        if (strcmp(env, "error") == 0) {
+            log_level = LOG_LEVEL_ERROR;
+        }
+        else if (strcmp(env, "warn") == 0) {
+            log_level = LOG_LEVEL_WARN;
+        }
+        else if (strcmp(env, "info") == 0) {
+            log_level = LOG_LEVEL_INFO;
+        }
+        else if (strcmp(env, "debug") == 0) {
+            log_level = LOG_LEVEL_DEBUG;
+        }
+    }
+
+    pthread_key_create(&log_key, log_threadexit);
+    atexit(log_flush);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, log_flusher, NULL);
+    pthread_detach(thread);
+}
+
+//This function initializes the logging facility: it reads the runtime log level from the environment
+//variable DARTNET_LOG and starts the log flusher thread. It should be called at the start of main().
+//Waiting messages are written out when the process exits.
+void log_init()
+{
+    pthread_once(&log_once, log_start);
+}
+
+//This function sets the runtime log level.
+void log_setlevel(int level)
+{
+    log_level = level;
+}
+
+//get the ring of the calling thread, create it on the first message of the thread
+static log_ring_t* log_getring()
+{
+    if (log_myring == NULL) {
+        log_init();
+        log_ring_t* ring = (log_ring_t*)calloc(1, sizeof(log_ring_t));
+        pthread_mutex_lock(&log_mutex);
+        ring->next = log_rings;
+        log_rings = ring;
+        pthread_mutex_unlock(&log_mutex);
+        pthread_setspecific(log_key, ring);
+        log_myring = ring;
+    }
+    return log_myring;
+}
+
+//This function writes a log message into the ring buffer of the calling thread.
+//It is called by the LOG macros, which check the log level first.
+void log_write(int level, const char* fmt, ...)
+{
+    log_ring_t* ring = log_getring();
+    unsigned int tail = ring->tail;
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= LOG_RING_SLOTS) {
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    log_msg_t* msg = &ring->msgs[tail & (LOG_RING_SLOTS - 1)];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(msg->text, LOG_MSG_LEN, fmt, ap);
+    va_end(ap);
+    if (len < 0) {
+        len = 0;
+    }
+    if (len >= LOG_MSG_LEN) {
+        // the message is cut, keep its line ending
+        len = LOG_MSG_LEN - 1;
+        msg->text[len - 1] = '\n';
+    }
+    msg->len = len;
+
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+//This function writes out all the waiting log messages now.
+void log_flush()
+{
+    pthread_mutex_lock(&log_mutex);
+    log_ring_t** link = &log_rings;
+    while (*link != NULL) {
+        log_ring_t* ring = *link;
+        int dead = __atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE);
+        unsigned int head = ring->head;
+        unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            log_msg_t* msg = &ring->msgs[head & (LOG_RING_SLOTS - 1)];
+            fwrite(msg->text, 1, msg->len, stdout);
+            head++;
+        }
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+        unsigned int dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+        if (dropped > 0) {
+            fprintf(stdout, "log: %u messages dropped\n", dropped);
+        }
+
+        if (dead) {
+            *link = ring->next;
+            free(ring);
+        }
+        else {
+            link = &ring->next;
+        }
+    }
+    fflush(stdout);
+    pthread_mutex_unlock(&log_mutex);
+}
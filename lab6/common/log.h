@@ -0,0 +1,59 @@
+//FILE: common/log.h
+//
+//Description: this file defines the logging facility used by all the DartNet processes
+//
+//Each thread writes its log messages into its own lock-free ring buffer, and a background
+//flusher thread writes the messages in all the rings to stdout. Logging a message formats it
+//into the ring and never blocks on the terminal. When the ring is full the message is dropped
+//and the drop is reported by the flusher.
+//
+//A message is logged at one of 4 levels. Messages above LOG_COMPILE_LEVEL (constants.h) are
+//compiled out. Messages above the runtime level are skipped with a single branch, the runtime
+//level is taken from the environment variable DARTNET_LOG ("error", "warn", "info" or "debug")
+//or set with log_setlevel().
+//
+//Date: October 17, 2026
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "constants.h"
+
+//log levels
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+//runtime log level, don't change it directly, use log_setlevel()
+extern int log_level;
+
+//log a message in printf() format at the given level
+#define LOG(level, ...) \
+    do { \
+        if ((level) <= LOG_COMPILE_LEVEL && (level) <= log_level) { \
+            log_write((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(...) LOG(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+//This function initializes the logging facility: it reads the runtime log level from the environment
+//variable DARTNET_LOG and starts the log flusher thread. It should be called at the start of main().
+//Waiting messages are written out when the process exits.
+void log_init();
+
+//This function sets the runtime log level.
+void log_setlevel(int level);
+
+//This function writes a log message into the ring buffer of the calling thread.
+//It is called by the LOG macros, which check the log level first.
+void log_write(int level, const char* fmt, ...);
+
+//This function writes out all the waiting log messages now.
+void log_flush();
+
+#endif
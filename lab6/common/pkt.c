@@ -3,6 +3,17 @@
 
 #include "pkt.h"
 
+//check a packet received in a frame of len bytes
+//the frame must contain the packet header and header.length bytes of packet data
+//return 1 if the packet is valid, otherwise return -1
+static int pkt_check(snp_pkt_t* pkt, int len)
+{
+    if (len < sizeof(snp_hdr_t) || pkt->header.length > MAX_PKT_LEN || len < SNP_PKT_LEN(pkt)) {
+        return -1;
+    }
+    return 1;
+}
+
 // overlay_sendpkt() is called by the SNP process to request the ON 
 // process to send a packet out to the overlay network. The 
 // ON process and SNP process are connected with a local TCP connection. 
@@ -10,104 +21,61 @@
 // in a sendpkt_arg_t data structure and sent over this TCP connection to the ON process. 
 // The parameter overlay_conn is the TCP connection's socket descriptior 
 // between the SNP process and the ON process.
-// When sending the sendpkt_arg_t data structure over the TCP connection between the SNP 
-// process and the ON process, use '!&'  and '!#' as delimiters. 
-// Send !& sendpkt_arg_t structure !# over the TCP connection.
+// The sendpkt_arg_t data structure is sent as one frame over the TCP connection, see common/frame.h.
 // Return 1 if sendpkt_arg_t data structure is sent successfully, otherwise return -1.
 int overlay_sendpkt(int nextNodeID, snp_pkt_t* pkt, int overlay_conn)
 {
-    sendpkt_arg_t *pkt_arg = (sendpkt_arg_t *)malloc(sizeof(sendpkt_arg_t));
-    pkt_arg->nextNodeID = nextNodeID;
-    pkt_arg->pkt = *pkt;
-    char bufstart[2];
-    char bufend[2];
-    bufstart[0] = '!';
-    bufstart[1] = '&';
-    bufend[0] = '!';
-    bufend[1] = '#';
-    if (send(overlay_conn, bufstart, 2, 0) < 0) {
-        free(pkt_arg);
-        return -1;
-    }
-    if(send(overlay_conn, pkt_arg, sizeof(sendpkt_arg_t), 0)<0) {
-        free(pkt_arg);
-        return -1;
+    // the sendpkt_arg_t is gathered from the next hop's node ID and the used bytes of the packet
+    struct iovec iov[2];
+    int iovcnt = 2;
+    iov[0].iov_base = &nextNodeID;
+    iov[0].iov_len = sizeof(int);
+    iov[1].iov_base = pkt;
+    iov[1].iov_len = SNP_PKT_LEN(pkt);
+    
+    return frame_sendbatch(overlay_conn, iov, &iovcnt, 1);
+}
+
+
+// overlay_sendpkt_batch() is called by the SNP process to send pktNum packets to the 
+// ON process with one system call. Packet pkts[i] is sent to next hop nextNodeIDs[i].
+// The parameter overlay_conn is the TCP connection's socket descriptior 
+// between the SNP process and the ON process.
+// Return 1 if all the sendpkt_arg_t data structures are sent successfully, otherwise return -1.
+int overlay_sendpkt_batch(int* nextNodeIDs, snp_pkt_t** pkts, int pktNum, int overlay_conn)
+{
+    if (pktNum <= 0) {
+        return 1;
     }
-    if(send(overlay_conn, bufend, 2, 0)<0) {
-        free(pkt_arg);
-        return -1;
+    
+    struct iovec iov[2 * pktNum];
+    int iovcnt[pktNum];
+    for (int i = 0; i < pktNum; i++) {
+        iov[2 * i].iov_base = &nextNodeIDs[i];
+        iov[2 * i].iov_len = sizeof(int);
+        iov[2 * i + 1].iov_base = pkts[i];
+        iov[2 * i + 1].iov_len = SNP_PKT_LEN(pkts[i]);
+        iovcnt[i] = 2;
     }
-    free(pkt_arg);
-    return 1;
+    
+    return frame_sendbatch(overlay_conn, iov, iovcnt, pktNum);
 }
 
 
 // overlay_recvpkt() function is called by the SNP process to receive a packet 
 // from the ON process. The parameter overlay_conn is the TCP connection's socket 
-// descriptior between the SNP process and the ON process. The packet is sent over 
-// the TCP connection between the SNP process and the ON process, and delimiters 
-// !& and !# are used. 
-// To receive the packet, this function uses a simple finite state machine(FSM)
-// PKTSTART1 -- starting point 
-// PKTSTART2 -- '!' received, expecting '&' to receive data 
-// PKTRECV -- '&' received, start receiving data
-// PKTSTOP1 -- '!' received, expecting '#' to finish receiving data 
+// descriptior between the SNP process and the ON process. The packet is sent 
+// as one frame over the TCP connection between the SNP process and the ON process.
 // Return 1 if a packet is received successfully, otherwise return -1.
 int overlay_recvpkt(snp_pkt_t* pkt, int overlay_conn)
 {
-    char buf[sizeof(snp_pkt_t)+2];
-    char c;
-    int idx = 0;
-    // state can be 0,1,2,3;
-    // 0 starting point
-    // 1 '!' received
-    // 2 '&' received, start receiving segment
-    // 3 '!' received,
-    // 4 '#' received, finish receiving segment
-    int state = 0;
-    while(recv(overlay_conn,&c,1,0)>0) {
-        if (state == 0) {
-            if(c=='!')
-                state = 1;
-        }
-        else if(state == 1) {
-            if(c=='&')
-                state = 2;
-            else
-                state = 0;
-        }
-        else if(state == 2) {
-            if(c=='!') {
-                buf[idx]=c;
-                idx++;
-                state = 3;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-            }
-        }
-        else if(state == 3) {
-            if(c=='#') {
-                buf[idx]=c;
-                idx++;
-                state = 0;
-                idx = 0;
-                memmove(pkt, buf, sizeof(snp_pkt_t));
-                return 1;
-            }
-            else if(c=='!') {
-                buf[idx]=c;
-                idx++;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-                state = 2;
-            }
+    int len;
+    do {
+        if ((len = frame_recv(overlay_conn, pkt, sizeof(snp_pkt_t))) < 0) {
+            return -1;
         }
-    }
-    return -1;
+    } while (pkt_check(pkt, len) < 0);
+    return 1;
 }
 
 
@@ -115,73 +83,25 @@ int overlay_recvpkt(snp_pkt_t* pkt, int overlay_conn)
 // This function is called by the ON process to receive a sendpkt_arg_t data structure.
 // A packet and the next hop's nodeID is encapsulated  in the sendpkt_arg_t structure.
 // The parameter network_conn is the TCP connection's socket descriptior between the
-// SNP process and the ON process. The sendpkt_arg_t structure is sent over the TCP 
-// connection between the SNP process and the ON process, and delimiters !& and !# are used. 
-// To receive the packet, this function uses a simple finite state machine(FSM)
-// PKTSTART1 -- starting point 
-// PKTSTART2 -- '!' received, expecting '&' to receive data 
-// PKTRECV -- '&' received, start receiving data
-// PKTSTOP1 -- '!' received, expecting '#' to finish receiving data
+// SNP process and the ON process. The sendpkt_arg_t structure is sent as one frame over 
+// the TCP connection between the SNP process and the ON process.
 // Return 1 if a sendpkt_arg_t structure is received successfully, otherwise return -1.
 int getpktToSend(snp_pkt_t* pkt, int* nextNode,int network_conn)
 {
-    sendpkt_arg_t * pkt_arg = (sendpkt_arg_t *)malloc(sizeof(sendpkt_arg_t));
-    char buf[sizeof(sendpkt_arg_t)+2];
-    char c;
-    int idx = 0;
-    // state can be 0,1,2,3;
-    // 0 starting point
-    // 1 '!' received
-    // 2 '&' received, start receiving segment
-    // 3 '!' received,
-    // 4 '#' received, finish receiving segment
-    int state = 0;
-    while(recv(network_conn,&c,1,0)>0) {
-        if (state == 0) {
-            if(c=='!')
-                state = 1;
+    // the frame is decoded in place, the packet is copied straight from the receive buffer into pkt
+    void* body;
+    int len;
+    while ((len = frame_next(network_conn, &body)) >= 0) {
+        if (len < SENDPKT_ARG_HDRLEN) {
+            continue;
         }
-        else if(state == 1) {
-            if(c=='&')
-                state = 2;
-            else
-                state = 0;
-        }
-        else if(state == 2) {
-            if(c=='!') {
-                buf[idx]=c;
-                idx++;
-                state = 3;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-            }
-        }
-        else if(state == 3) {
-            if(c=='#') {
-                buf[idx]=c;
-                idx++;
-                state = 0;
-                idx = 0;
-                memmove(pkt_arg, buf, sizeof(sendpkt_arg_t));   // send pkt size = sizeof(sendpkt_arg_t)
-                memmove(pkt, &pkt_arg->pkt, sizeof(snp_pkt_t));
-                *nextNode = pkt_arg->nextNodeID;
-                free(pkt_arg);
-                return 1;
-            }
-            else if(c=='!') {
-                buf[idx]=c;
-                idx++;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-                state = 2;
-            }
+        int pktlen = len - offsetof(sendpkt_arg_t, pkt);
+        memcpy(pkt, (char*)body + offsetof(sendpkt_arg_t, pkt), pktlen < sizeof(snp_pkt_t) ? pktlen : sizeof(snp_pkt_t));
+        if (pkt_check(pkt, pktlen) > 0) {
+            memcpy(nextNode, (char*)body + offsetof(sendpkt_arg_t, nextNodeID), sizeof(int));
+            return 1;
         }
     }
-    free(pkt_arg);
     return -1;
 }
 
@@ -192,28 +112,38 @@ int getpktToSend(snp_pkt_t* pkt, int* nextNode,int network_conn)
 // a neighbor in the overlay network. The ON process calls this function 
 // to forward the packet to SNP process. 
 // The parameter network_conn is the TCP connection's socket descriptior between the SNP 
-// process and ON process. The packet is sent over the TCP connection between the SNP process 
-// and ON process, and delimiters !& and !# are used. 
-// Send !& packet data !# over the TCP connection.
+// process and ON process. The packet is sent as one frame over the TCP connection 
+// between the SNP process and ON process.
 // Return 1 if the packet is sent successfully, otherwise return -1.
 int forwardpktToSNP(snp_pkt_t* pkt, int network_conn)
 {
-    char bufstart[2];
-    char bufend[2];
-    bufstart[0] = '!';
-    bufstart[1] = '&';
-    bufend[0] = '!';
-    bufend[1] = '#';
-    if (send(network_conn, bufstart, 2, 0) < 0) {
+    if (frame_send(network_conn, pkt, SNP_PKT_LEN(pkt)) < 0) {
         return -1;
     }
-    if(send(network_conn, pkt, sizeof(snp_pkt_t), 0)<0) {
-        return -1;
+    return 1;
+}
+
+
+// forwardpktToSNP_batch() is called by the ON process to forward pktNum packets 
+// received from the neighbors to the SNP process with one system call, in order.
+// The parameter network_conn is the TCP connection's socket descriptior between the SNP 
+// process and ON process.
+// Return 1 if all the packets are sent successfully, otherwise return -1.
+int forwardpktToSNP_batch(snp_pkt_t** pkts, int pktNum, int network_conn)
+{
+    if (pktNum <= 0) {
+        return 1;
     }
-    if(send(network_conn, bufend, 2, 0)<0) {
-        return -1;
+    
+    struct iovec iov[pktNum];
+    int iovcnt[pktNum];
+    for (int i = 0; i < pktNum; i++) {
+        iov[i].iov_base = pkts[i];
+        iov[i].iov_len = SNP_PKT_LEN(pkts[i]);
+        iovcnt[i] = 1;
     }
-    return 1;
+    
+    return frame_sendbatch(network_conn, iov, iovcnt, pktNum);
 }
 
 
@@ -221,25 +151,12 @@ int forwardpktToSNP(snp_pkt_t* pkt, int network_conn)
 // sendpkt() function is called by the ON process to send a packet 
 // received from the SNP process to the next hop.
 // Parameter conn is the TCP connection's socket descritpor to the next hop node.
-// The packet is sent over the TCP connection between the ON process and a neighboring node,
-// and delimiters !& and !# are used. 
-// Send !& packet data !# over the TCP connection
+// The packet is sent as one frame over the TCP connection between the ON process 
+// and a neighboring node.
 // Return 1 if the packet is sent successfully, otherwise return -1.
 int sendpkt(snp_pkt_t* pkt, int conn)
 {
-    char bufstart[2];
-    char bufend[2];
-    bufstart[0] = '!';
-    bufstart[1] = '&';
-    bufend[0] = '!';
-    bufend[1] = '#';
-    if (send(conn, bufstart, 2, 0) < 0) {
-        return -1;
-    }
-    if(send(conn, pkt, sizeof(snp_pkt_t), 0)<0) {
-        return -1;
-    }
-    if(send(conn, bufend, 2, 0)<0) {
+    if (frame_send(conn, pkt, SNP_PKT_LEN(pkt)) < 0) {
         return -1;
     }
     return 1;
@@ -247,70 +164,39 @@ int sendpkt(snp_pkt_t* pkt, int conn)
 
 
 
+// pollpkt() function is called by the ON process to receive a packet from a neighbor
+// without waiting, when the connection to the neighbor is served by an event loop (epoll).
+// Parameter conn is the TCP connection's socket descritpor to a neighbor.
+// Return 1 if a packet is received, 0 if no whole packet has arrived yet (wait until
+// the connection is readable), or -1 if the connection is closed.
+int pollpkt(snp_pkt_t* pkt, int conn)
+{
+    void* body;
+    int len;
+    while ((len = frame_poll(conn, &body)) >= 0) {
+        memcpy(pkt, body, len < sizeof(snp_pkt_t) ? len : sizeof(snp_pkt_t));
+        if (pkt_check(pkt, len) > 0) {
+            return 1;
+        }
+    }
+    return len == FRAME_AGAIN ? 0 : -1;
+}
+
+
+
 // recvpkt() function is called by the ON process to receive 
 // a packet from a neighbor in the overlay network.
 // Parameter conn is the TCP connection's socket descritpor to a neighbor.
-// The packet is sent over the TCP connection  between the ON process and the neighbor,
-// and delimiters !& and !# are used. 
-// To receive the packet, this function uses a simple finite state machine(FSM)
-// PKTSTART1 -- starting point 
-// PKTSTART2 -- '!' received, expecting '&' to receive data 
-// PKTRECV -- '&' received, start receiving data
-// PKTSTOP1 -- '!' received, expecting '#' to finish receiving data 
+// The packet is sent as one frame over the TCP connection between the ON process 
+// and the neighbor.
 // Return 1 if the packet is received successfully, otherwise return -1.
 int recvpkt(snp_pkt_t* pkt, int conn)
 {
-    char buf[sizeof(snp_pkt_t)+2];
-    char c;
-    int idx = 0;
-    // state can be 0,1,2,3;
-    // 0 starting point
-    // 1 '!' received
-    // 2 '&' received, start receiving segment
-    // 3 '!' received,
-    // 4 '#' received, finish receiving segment
-    int state = 0;
-    while(recv(conn,&c,1,0)>0) {
-        if (state == 0) {
-            if(c=='!')
-                state = 1;
+    int len;
+    do {
+        if ((len = frame_recv(conn, pkt, sizeof(snp_pkt_t))) < 0) {
+            return -1;
         }
-        else if(state == 1) {
-            if(c=='&')
-                state = 2;
-            else
-                state = 0;
-        }
-        else if(state == 2) {
-            if(c=='!') {
-                buf[idx]=c;
-                idx++;
-                state = 3;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-            }
-        }
-        else if(state == 3) {
-            if(c=='#') {
-                buf[idx]=c;
-                idx++;
-                state = 0;
-                idx = 0;
-                memmove(pkt, buf, sizeof(snp_pkt_t));
-                return 1;
-            }
-            else if(c=='!') {
-                buf[idx]=c;
-                idx++;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-                state = 2;
-            }
-        }
-    }
-    return -1;
+    } while (pkt_check(pkt, len) < 0);
+    return 1;
 }
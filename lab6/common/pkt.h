@@ -3,13 +3,20 @@
 
 #include "constants.h"
 #include <stdlib.h>
+#include <stddef.h>
 #include <sys/socket.h>
 #include <string.h>
+#include "frame.h"
 
 
 //packet type definition, used for type field in packet header
 #define	ROUTE_UPDATE 1
 #define SNP 2	
+#define LINK_STATE 3
+#define LINK_PROBE 4		//sent by an ON process to a neighbor as a heartbeat and to measure the link, it is not forwarded to the SNP process
+#define LINK_PROBE_REPLY 5	//a LINK_PROBE sent back by the neighbor
+#define LINK_COST 6		//sent by the ON process to the local SNP process when the measured cost of a link has changed or the link went down or up
+#define LINK_RESYNC 7		//sent by the ON process to the local SNP process when routing packets to some neighbors were dropped
 
 //SNP packet format definition
 typedef struct snpheader {
@@ -19,11 +26,18 @@ typedef struct snpheader {
   unsigned short int type;	  //type of the packet 
 } snp_hdr_t;
 
+//the packet data starts 4-byte aligned and has room for a whole seg_t, so the SNP process
+//receives a segment straight into the data of a packet and sends the packet data to the SRT process
+//as a segment, without copying the segment
 typedef struct packet {
   snp_hdr_t header;
   char data[MAX_PKT_LEN];
 } snp_pkt_t;
 
+//Only the used bytes of a packet are sent over a connection: the packet header and header.length bytes of packet data.
+//SNP_PKT_LEN is the number of bytes sent for a packet
+#define SNP_PKT_LEN(pkt) (sizeof(snp_hdr_t) + (pkt)->header.length)
+
 
 //route update packet definition
 //for a route update packet, the route update information will be stored in the data field of a packet 
@@ -35,11 +49,57 @@ typedef struct routeupdate_entry {
 } routeupdate_entry_t;
 
 //route update packet format
+//the entries are built and read in place in the data field of a packet
 typedef struct pktrt{
         unsigned int entryNum;	//number of entries contained in this route update packet
-        routeupdate_entry_t entry[MAX_NODE_NUM];
+        routeupdate_entry_t entry[];
 } pkt_routeupdate_t;
 
+//ROUTEUPDATE_LEN is the length of a route update packet's data with entryNum entries
+#define ROUTEUPDATE_LEN(entryNum) (offsetof(pkt_routeupdate_t, entry) + (entryNum) * sizeof(routeupdate_entry_t))
+
+//ROUTEUPDATE_MAX_ENTRIES is the max number of entries in one route update packet
+//a distance vector with more entries is sent in several route update packets, each of which is handled on its own
+#define ROUTEUPDATE_MAX_ENTRIES ((MAX_PKT_LEN - ROUTEUPDATE_LEN(0)) / sizeof(routeupdate_entry_t))
+
+
+//link state advertisement (LSA) packet definition, used in link state routing mode (see network/lsdb.h)
+//an LSA lists the direct links of its origin node, it is flooded to all the nodes in the data field of a packet
+
+//the origin node of an LSA sets this flag in the first LSA it sends after it starts,
+//a neighbor receiving it from the origin sends back all the LSAs it has
+#define LSA_FLAG_SYNC 1
+
+//LSA packet format
+//each link is the node ID of a neighbor of the origin node and the direct link cost to it
+typedef struct pktlsa {
+        unsigned int originID;	//node ID of the node whose links are listed
+        unsigned int seqNum;	//sequence number, a newer LSA of the same origin has a larger sequence number
+        unsigned int flags;	//LSA_FLAG_SYNC or 0
+        unsigned int linkNum;	//number of links contained in this LSA
+        routeupdate_entry_t link[];
+} pkt_lsa_t;
+
+//LSA_LEN is the length of an LSA packet's data with linkNum links
+#define LSA_LEN(linkNum) (offsetof(pkt_lsa_t, link) + (linkNum) * sizeof(routeupdate_entry_t))
+
+//LSA_MAX_LINKS is the max number of links in an LSA, a node can't have more neighbors than this in link state mode
+#define LSA_MAX_LINKS ((MAX_PKT_LEN - LSA_LEN(0)) / sizeof(routeupdate_entry_t))
+
+
+
+//link probe packet format, the data of a LINK_PROBE packet is echoed back in the LINK_PROBE_REPLY packet
+typedef struct pktprobe {
+        unsigned int seqNum;	//probe number
+        unsigned int sendTime;	//time the probe was sent in microseconds on the sender's clock, it wraps around
+} pkt_probe_t;
+
+//a LINK_COST packet carries the new direct link costs to neighbors in the route update format:
+//each entry is the node ID of a neighbor and the direct link cost to it
+//a link that went down is reported with cost INFINITE_COST, a link that came back up with its measured cost
+
+//a LINK_RESYNC packet lists in the route update format the neighbors whose send queue in the ON process was so full that
+//route updates or LSAs to them were dropped, the costs are not used. The SNP process sends them its whole routing state again.
 
 
 // sendpkt_arg_t data structure is used in the overlay_sendpkt() function. 
@@ -56,6 +116,12 @@ typedef struct sendpktargument {
   snp_pkt_t pkt;         //the packet to be sent
 } sendpkt_arg_t;
 
+//Only the used bytes of a sendpkt_arg_t are sent: the next hop's node ID, the packet header and the packet data.
+//SENDPKT_ARG_HDRLEN is the length of a sendpkt_arg_t without packet data.
+#define SENDPKT_ARG_HDRLEN offsetof(sendpkt_arg_t, pkt.data)
+//SENDPKT_ARG_LEN is the number of bytes sent for a sendpkt_arg_t
+#define SENDPKT_ARG_LEN(pkt_arg) (SENDPKT_ARG_HDRLEN + (pkt_arg)->pkt.header.length)
+
 
 // overlay_sendpkt() is called by the SNP process to request the ON 
 // process to send a packet out to the overlay network. The 
@@ -64,25 +130,25 @@ typedef struct sendpktargument {
 // in a sendpkt_arg_t data structure and sent over this TCP connection to the ON process. 
 // The parameter overlay_conn is the TCP connection's socket descriptior 
 // between the SNP process and the ON process.
-// When sending the sendpkt_arg_t data structure over the TCP connection between the SNP 
-// process and the ON process, use '!&'  and '!#' as delimiters. 
-// Send !& sendpkt_arg_t structure !# over the TCP connection.
+// The sendpkt_arg_t data structure is sent as one frame over the TCP connection, see common/frame.h.
 // Return 1 if sendpkt_arg_t data structure is sent successfully, otherwise return -1.
 int overlay_sendpkt(int nextNodeID, snp_pkt_t* pkt, int overlay_conn);
 
 
+// overlay_sendpkt_batch() is called by the SNP process to send pktNum packets to the 
+// ON process with one system call. Packet pkts[i] is sent to next hop nextNodeIDs[i].
+// The parameter overlay_conn is the TCP connection's socket descriptior 
+// between the SNP process and the ON process.
+// Return 1 if all the sendpkt_arg_t data structures are sent successfully, otherwise return -1.
+int overlay_sendpkt_batch(int* nextNodeIDs, snp_pkt_t** pkts, int pktNum, int overlay_conn);
+
+
 
 
 // overlay_recvpkt() function is called by the SNP process to receive a packet 
 // from the ON process. The parameter overlay_conn is the TCP connection's socket 
-// descriptior between the SNP process and the ON process. The packet is sent over 
-// the TCP connection between the SNP process and the ON process, and delimiters 
-// !& and !# are used. 
-// To receive the packet, this function uses a simple finite state machine(FSM)
-// PKTSTART1 -- starting point 
-// PKTSTART2 -- '!' received, expecting '&' to receive data 
-// PKTRECV -- '&' received, start receiving data
-// PKTSTOP1 -- '!' received, expecting '#' to finish receiving data 
+// descriptior between the SNP process and the ON process. The packet is sent 
+// as one frame over the TCP connection between the SNP process and the ON process.
 // Return 1 if a packet is received successfully, otherwise return -1.
 int overlay_recvpkt(snp_pkt_t* pkt, int overlay_conn);
 
@@ -91,13 +157,8 @@ int overlay_recvpkt(snp_pkt_t* pkt, int overlay_conn);
 // This function is called by the ON process to receive a sendpkt_arg_t data structure.
 // A packet and the next hop's nodeID is encapsulated  in the sendpkt_arg_t structure.
 // The parameter network_conn is the TCP connection's socket descriptior between the
-// SNP process and the ON process. The sendpkt_arg_t structure is sent over the TCP 
-// connection between the SNP process and the ON process, and delimiters !& and !# are used. 
-// To receive the packet, this function uses a simple finite state machine(FSM)
-// PKTSTART1 -- starting point 
-// PKTSTART2 -- '!' received, expecting '&' to receive data 
-// PKTRECV -- '&' received, start receiving data
-// PKTSTOP1 -- '!' received, expecting '#' to finish receiving data
+// SNP process and the ON process. The sendpkt_arg_t structure is sent as one frame over 
+// the TCP connection between the SNP process and the ON process.
 // Return 1 if a sendpkt_arg_t structure is received successfully, otherwise return -1.
 int getpktToSend(snp_pkt_t* pkt, int* nextNode,int network_conn);
 
@@ -108,20 +169,27 @@ int getpktToSend(snp_pkt_t* pkt, int* nextNode,int network_conn);
 // a neighbor in the overlay network. The ON process calls this function 
 // to forward the packet to SNP process. 
 // The parameter network_conn is the TCP connection's socket descriptior between the SNP 
-// process and ON process. The packet is sent over the TCP connection between the SNP process 
-// and ON process, and delimiters !& and !# are used. 
-// Send !& packet data !# over the TCP connection.
+// process and ON process. The packet is sent as one frame over the TCP connection 
+// between the SNP process and ON process.
 // Return 1 if the packet is sent successfully, otherwise return -1.
 int forwardpktToSNP(snp_pkt_t* pkt, int network_conn);
 
 
 
+// forwardpktToSNP_batch() is called by the ON process to forward pktNum packets 
+// received from the neighbors to the SNP process with one system call, in order.
+// The parameter network_conn is the TCP connection's socket descriptior between the SNP 
+// process and ON process.
+// Return 1 if all the packets are sent successfully, otherwise return -1.
+int forwardpktToSNP_batch(snp_pkt_t** pkts, int pktNum, int network_conn);
+
+
+
 // sendpkt() function is called by the ON process to send a packet 
 // received from the SNP process to the next hop.
 // Parameter conn is the TCP connection's socket descritpor to the next hop node.
-// The packet is sent over the TCP connection between the ON process and a neighboring node,
-// and delimiters !& and !# are used. 
-// Send !& packet data !# over the TCP connection
+// The packet is sent as one frame over the TCP connection between the ON process 
+// and a neighboring node.
 // Return 1 if the packet is sent successfully, otherwise return -1.
 int sendpkt(snp_pkt_t* pkt, int conn);
 
@@ -130,16 +198,20 @@ int sendpkt(snp_pkt_t* pkt, int conn);
 // recvpkt() function is called by the ON process to receive 
 // a packet from a neighbor in the overlay network.
 // Parameter conn is the TCP connection's socket descritpor to a neighbor.
-// The packet is sent over the TCP connection  between the ON process and the neighbor,
-// and delimiters !& and !# are used. 
-// To receive the packet, this function uses a simple finite state machine(FSM)
-// PKTSTART1 -- starting point 
-// PKTSTART2 -- '!' received, expecting '&' to receive data 
-// PKTRECV -- '&' received, start receiving data
-// PKTSTOP1 -- '!' received, expecting '#' to finish receiving data 
+// The packet is sent as one frame over the TCP connection between the ON process 
+// and the neighbor.
 // Return 1 if the packet is received successfully, otherwise return -1.
 int recvpkt(snp_pkt_t* pkt, int conn);
 
 
 
+// pollpkt() function is called by the ON process to receive a packet from a neighbor
+// without waiting, when the connection to the neighbor is served by an event loop (epoll).
+// Parameter conn is the TCP connection's socket descritpor to a neighbor.
+// Return 1 if a packet is received, 0 if no whole packet has arrived yet (wait until
+// the connection is readable), or -1 if the connection is closed.
+int pollpkt(snp_pkt_t* pkt, int conn);
+
+
+
 #endif
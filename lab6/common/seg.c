@@ -1,39 +1,73 @@
 
 #include "seg.h"
+#include "checksum.h"
+#include "log.h"
 
+//decode a sendseg_arg_t received in a frame of len bytes at body
+//the frame is decoded in place: the node ID is stored in nodeID and the segment is copied straight into segPtr
+//the frame must contain the node ID, the segment header and header.length bytes of segment data
+//if the segment data has odd number of octets, the octet after the data is cleared for checksum calculation
+//return 1 if the sendseg_arg_t is valid, otherwise return -1
+static int seg_decode(const char* body, int len, int* nodeID, seg_t* segPtr)
+{
+    if (len < SENDSEG_ARG_HDRLEN) {
+        LOG_WARN("seg truncated!!!\n");
+        return -1;
+    }
+    int seglen = len - offsetof(sendseg_arg_t, seg);
+    memcpy(segPtr, body + offsetof(sendseg_arg_t, seg), seglen < sizeof(seg_t) ? seglen : sizeof(seg_t));
+    if (segPtr->header.length > MAX_SEG_LEN || len < SENDSEG_ARG_HDRLEN + segPtr->header.length) {
+        LOG_WARN("seg truncated!!!\n");
+        return -1;
+    }
+    memcpy(nodeID, body + offsetof(sendseg_arg_t, nodeID), sizeof(int));
+    if (segPtr->header.length % 2 == 1 && segPtr->header.length < MAX_SEG_LEN) {
+        segPtr->data[segPtr->header.length] = 0;
+    }
+    return 1;
+}
 
 //SRT process uses this function to send a segment and its destination node ID in a sendseg_arg_t structure to SNP process to send out. 
 //Parameter network_conn is the TCP descriptor of the connection between the SRT process and the SNP process. 
 //Return 1 if a sendseg_arg_t is succefully sent, otherwise return -1.
 int snp_sendseg(int network_conn, int dest_nodeID, seg_t* segPtr)
 {
-    char bufstart[2];
-    char bufend[2];
-    bufstart[0] = '!';
-    bufstart[1] = '&';
-    bufend[0] = '!';
-    bufend[1] = '#';
-    
-    sendseg_arg_t *seg_arg = (sendseg_arg_t *)malloc(sizeof(sendseg_arg_t));
-    seg_arg->nodeID = dest_nodeID;
     segPtr->header.checksum = checksum(segPtr);
-    seg_arg->seg = *segPtr;
     //printf("send out checksum is %u\n", segPtr->header.checksum);
     
-    if (send(network_conn, bufstart, 2, 0) < 0) {
-        free(seg_arg);
-        return -1;
-    }
-    if(send(network_conn, seg_arg, sizeof(sendseg_arg_t), 0)<0) {
-        free(seg_arg);
-        return -1;
+    // the sendseg_arg_t is gathered from the node ID and the used bytes of the segment
+    struct iovec iov[2];
+    int iovcnt = 2;
+    iov[0].iov_base = &dest_nodeID;
+    iov[0].iov_len = sizeof(int);
+    iov[1].iov_base = segPtr;
+    iov[1].iov_len = sizeof(srt_hdr_t) + segPtr->header.length;
+    
+    return frame_sendbatch(network_conn, iov, &iovcnt, 1);
+}
+
+//SRT process uses this function to send segNum segments to the same destination node with one system call.
+//It is used to send a window of segments from the send buffer. Unlike snp_sendseg(), the segments must already carry
+//their checksum (see checksum() and seg_setacknum()), so a segment that is sent again is not summed again.
+//Parameter network_conn is the TCP descriptor of the connection between the SRT process and the SNP process. 
+//Return 1 if all the sendseg_arg_ts are succefully sent, otherwise return -1.
+int snp_sendseg_batch(int network_conn, int dest_nodeID, seg_t** segPtrs, int segNum)
+{
+    if (segNum <= 0) {
+        return 1;
     }
-    if(send(network_conn, bufend, 2, 0)<0) {
-        free(seg_arg);
-        return -1;
+    
+    struct iovec iov[2 * segNum];
+    int iovcnt[segNum];
+    for (int i = 0; i < segNum; i++) {
+        iov[2 * i].iov_base = &dest_nodeID;
+        iov[2 * i].iov_len = sizeof(int);
+        iov[2 * i + 1].iov_base = segPtrs[i];
+        iov[2 * i + 1].iov_len = sizeof(srt_hdr_t) + segPtrs[i]->header.length;
+        iovcnt[i] = 2;
     }
-    free(seg_arg);
-    return 1;
+    
+    return frame_sendbatch(network_conn, iov, iovcnt, segNum);
 }
 
 //SRT process uses this function to receive a  sendseg_arg_t structure which contains a segment and its src node ID from the SNP process. 
@@ -42,76 +76,27 @@ int snp_sendseg(int network_conn, int dest_nodeID, seg_t* segPtr)
 //Return 1 if a sendseg_arg_t is succefully received, otherwise return -1.
 int snp_recvseg(int network_conn, int* src_nodeID, seg_t* segPtr)
 {
-    sendseg_arg_t *seg_arg = (sendseg_arg_t *)malloc(sizeof(sendseg_arg_t));
-    char buf[sizeof(sendseg_arg_t)+2];
-    char c;
-    int idx = 0;
-    // state can be 0,1,2,3;
-    // 0 starting point
-    // 1 '!' received
-    // 2 '&' received, start receiving segment
-    // 3 '!' received,
-    // 4 '#' received, finish receiving segment
-    int state = 0;
-    while(recv(network_conn,&c,1,0)>0) {
-        if (state == 0) {
-            if(c=='!')
-                state = 1;
+    // each frame received from the SNP process carries the used bytes of one sendseg_arg_t
+    void* body;
+    int len;
+    while ((len = frame_next(network_conn, &body)) >= 0) {
+        if (seg_decode(body, len, src_nodeID, segPtr) < 0) {
+            continue;
         }
-        else if(state == 1) {
-            if(c=='&')
-                state = 2;
-            else
-                state = 0;
-        }
-        else if(state == 2) {
-            if(c=='!') {
-                buf[idx]=c;
-                idx++;
-                state = 3;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-            }
+        
+        if (seglost(segPtr) > 0){
+            LOG_DEBUG("seg lost!!!\n");
+            continue;
         }
-        else if(state == 3) {
-            if(c=='#') {
-                buf[idx]=c;
-                idx++;
-                state = 0;
-                idx = 0;
-                
-                memmove(seg_arg, buf, sizeof(sendseg_arg_t));
-                memmove(segPtr, &seg_arg->seg, sizeof(seg_t));
-                *src_nodeID = seg_arg->nodeID;
-                
-                if (seglost(segPtr) > 0){
-                    printf("seg lost!!!\n");
-                    continue;
-                }
-                
-                if (checkchecksum(segPtr) < 0){
-                    printf("seg corrupted!!!\n");
-                    continue;
-                }
-                
-                free(seg_arg);
-                return 1;
-            }
-            else if(c=='!') {
-                buf[idx]=c;
-                idx++;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-                state = 2;
-            }
+        
+        if (checkchecksum(segPtr) < 0){
+            LOG_DEBUG("seg corrupted!!!\n");
+            continue;
         }
+        
+        return 1;
     }
     
-    free(seg_arg);
     return -1;
 }
 
@@ -120,67 +105,14 @@ int snp_recvseg(int network_conn, int* src_nodeID, seg_t* segPtr)
 //Return 1 if a sendseg_arg_t is succefully received, otherwise return -1.
 int getsegToSend(int tran_conn, int* dest_nodeID, seg_t* segPtr)
 {
-    sendseg_arg_t *seg_arg = (sendseg_arg_t *)malloc(sizeof(sendseg_arg_t));
-    char buf[sizeof(sendseg_arg_t)+2];
-    char c;
-    int idx = 0;
-    // state can be 0,1,2,3;
-    // 0 starting point
-    // 1 '!' received
-    // 2 '&' received, start receiving segment
-    // 3 '!' received,
-    // 4 '#' received, finish receiving segment
-    int state = 0;
-    while(recv(tran_conn,&c,1,0)>0) {
-        if (state == 0) {
-            if(c=='!')
-                state = 1;
-        }
-        else if(state == 1) {
-            if(c=='&')
-                state = 2;
-            else
-                state = 0;
-        }
-        else if(state == 2) {
-            if(c=='!') {
-                buf[idx]=c;
-                idx++;
-                state = 3;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-            }
-        }
-        else if(state == 3) {
-            if(c=='#') {
-                buf[idx]=c;
-                idx++;
-                state = 0;
-                idx = 0;
-                
-                memmove(seg_arg, buf, sizeof(sendseg_arg_t));
-                memmove(segPtr, &seg_arg->seg, sizeof(seg_t));
-                *dest_nodeID = seg_arg->nodeID;
-                free(seg_arg);
-                return 1;
-            }
-            else if(c=='!') {
-                buf[idx]=c;
-                idx++;
-            }
-            else {
-                buf[idx]=c;
-                idx++;
-                state = 2;
-            }
+    void* body;
+    int len;
+    do {
+        if ((len = frame_next(tran_conn, &body)) < 0) {
+            return -1;
         }
-    }
-    
-    free(seg_arg);
-    return -1;
-    
+    } while (seg_decode(body, len, dest_nodeID, segPtr) < 0);
+    return 1;
 }
 
 //SNP process uses this function to send a sendseg_arg_t structure which contains a segment and its src node ID to the SRT process.
@@ -188,30 +120,14 @@ int getsegToSend(int tran_conn, int* dest_nodeID, seg_t* segPtr)
 //Return 1 if a sendseg_arg_t is succefully sent, otherwise return -1.
 int forwardsegToSRT(int tran_conn, int src_nodeID, seg_t* segPtr)
 {
-    sendseg_arg_t *seg_arg = (sendseg_arg_t *)malloc(sizeof(sendseg_arg_t));
-    seg_arg->nodeID = src_nodeID;
-    seg_arg->seg = *segPtr;
-    
-    char bufstart[2];
-    char bufend[2];
-    bufstart[0] = '!';
-    bufstart[1] = '&';
-    bufend[0] = '!';
-    bufend[1] = '#';
-    if (send(tran_conn, bufstart, 2, 0) < 0) {
-        free(seg_arg);
-        return -1;
-    }
-    if(send(tran_conn, seg_arg, sizeof(sendseg_arg_t), 0)<0) {
-        free(seg_arg);
-        return -1;
-    }
-    if(send(tran_conn, bufend, 2, 0)<0) {
-        free(seg_arg);
-        return -1;
-    }
-    free(seg_arg);
-    return 1;
+    struct iovec iov[2];
+    int iovcnt = 2;
+    iov[0].iov_base = &src_nodeID;
+    iov[0].iov_len = sizeof(int);
+    iov[1].iov_base = segPtr;
+    iov[1].iov_len = sizeof(srt_hdr_t) + segPtr->header.length;
+    
+    return frame_sendbatch(tran_conn, iov, &iovcnt, 1);
 }
 
 // for seglost(seg_t* segment):
@@ -228,12 +144,12 @@ int seglost(seg_t* segPtr)
         int rand2 = rand();
         //50% probability of losing a segment
         if(rand2 % 2 == 0) {
-            printf("seg lost!!!\n");
+            LOG_DEBUG("seg lost!!!\n");
             return 1;
         }
         //50% chance of invalid checksum
         else {
-            printf("seg corrupted!!!\n");
+            LOG_DEBUG("seg corrupted!!!\n");
             //get data length
             int len = sizeof(srt_hdr_t)+segPtr->header.length;
             //get a random bit that will be flipped
@@ -258,59 +174,19 @@ int seglost(seg_t* segPtr)
 unsigned short checksum(seg_t* segment)
 {
     segment->header.checksum = 0;
-    register long sum = 0;
-    int count = 0;
-    /* Compute Internet Checksum for "count" bytes
-     *         beginning at location "addr".
-     */
-    
-    //16-bit data type
-    unsigned short* addr = (unsigned short*) segment;
-    
-    count = sizeof(srt_hdr_t) + segment->header.length;
-    
-    if (count % 2 > 0){
-        count++;
-        segment->data[segment->header.length] = 0;
-    }
-    
-    while(count > 1) {
-        /*  This is the inner loop */
-        sum += (unsigned short)(*addr);
-        
-        if(sum & 0x10000) {
-            sum = (sum & 0xffff) + (sum >> 16);
-        }
-        //printf("Now sum = %lu\n", sum);
-        count -= 2;
-        addr++;
-    }
-    return ~sum;
-    
-    /*
-    segment->header.checksum = 0;
-    if(segment->header.length%2==1)
+    int count = sizeof(srt_hdr_t) + segment->header.length;
+    if (count % 2 > 0) {
         segment->data[segment->header.length] = 0;
-    
-    long sum = 0;
-    //len is the number of 16-bit data to calculate the checksum
-    int len = sizeof(srt_hdr_t)+segment->header.length;
-    if(len%2==1)
-        len++;
-    len = len/2;
-    unsigned short* temp = (unsigned short*)segment;
-    
-    while(len > 0){
-        sum += *temp;
-        temp++;
-        //if overflow, round the most significant 1
-        if(sum & 0x10000)
-            sum = (sum & 0xFFFF) + 1;
-        len --;
     }
-    
-    return ~sum;
-    */
+    return checksum_compute(segment, count);
+}
+
+//This function rewrites the ack number of a segment that carries its checksum, and fixes up the checksum
+//from the old and the new ack number without summing the segment again (see checksum_update32()).
+void seg_setacknum(seg_t* segment, unsigned int ack_num)
+{
+    segment->header.checksum = checksum_update32(segment->header.checksum, segment->header.ack_num, ack_num);
+    segment->header.ack_num = ack_num;
 }
 
 //Check the checksum in the segment,
@@ -318,38 +194,8 @@ unsigned short checksum(seg_t* segment)
 //return -1 if the checksum is invalid
 int checkchecksum(seg_t* segment)
 {
-    long sum = 0;
-    //len is the number of 16-bit data to calculate the checksum
-    int len = sizeof(srt_hdr_t)+segment->header.length;
-    if(len%2==1)
-        len++;
-    len = len/2;
-    unsigned short* temp = (unsigned short*)segment;
-    
-    while(len > 0){
-        sum += *temp;
-        temp++;
-        //if overflow, round the most significant 1
-        if(sum & 0x10000)
-            sum = (sum & 0xFFFF) + 1;
-        len --;
-    }
-    
-    unsigned short result =~sum;
-    printf("recomputed checksum = %u\n", result);
-    if(result == 0)
+    if (checksum_compute(segment, sizeof(srt_hdr_t) + segment->header.length) == 0)
         return 1;
     else
         return -1;
-    
-    /*
-    unsigned short check_sum = checksum(segment);
-    //printf("recomputed checksum = %u\n", check_sum);
-    if (check_sum == 0){
-        return 1;
-    }
-    else{
-        return -1;
-    }
-    */
 }
@@ -15,9 +15,11 @@
 #include "constants.h"
 #include "stdio.h"
 #include <stdlib.h>
+#include <stddef.h>
 #include <sys/socket.h>
 #include <string.h>
 #include <pthread.h>
+#include "frame.h"
 
 //Segment type definition. Used by SRT.
 #define	SYN 0
@@ -56,11 +58,25 @@ typedef struct sendsegargument {
 	seg_t seg;		//a segment 
 } sendseg_arg_t;
 
+//Only the used bytes of a sendseg_arg_t are sent over the connection between the SRT process and the SNP process:
+//the node ID, the segment header and header.length bytes of segment data.
+//SENDSEG_ARG_HDRLEN is the length of a sendseg_arg_t without segment data.
+#define SENDSEG_ARG_HDRLEN offsetof(sendseg_arg_t, seg.data)
+//SENDSEG_ARG_LEN is the number of bytes sent for a sendseg_arg_t
+#define SENDSEG_ARG_LEN(seg_arg) (SENDSEG_ARG_HDRLEN + (seg_arg)->seg.header.length)
+
 //SRT process uses this function to send a segment and its destination node ID in a sendseg_arg_t structure to SNP process to send out. 
 //Parameter network_conn is the TCP descriptor of the connection between the SRT process and the SNP process. 
 //Return 1 if a sendseg_arg_t is succefully sent, otherwise return -1.
 int snp_sendseg(int network_conn, int dest_nodeID, seg_t* segPtr);
 
+//SRT process uses this function to send segNum segments to the same destination node with one system call.
+//It is used to send a window of segments from the send buffer. Unlike snp_sendseg(), the segments must already carry
+//their checksum (see checksum() and seg_setacknum()), so a segment that is sent again is not summed again.
+//Parameter network_conn is the TCP descriptor of the connection between the SRT process and the SNP process. 
+//Return 1 if all the sendseg_arg_ts are succefully sent, otherwise return -1.
+int snp_sendseg_batch(int network_conn, int dest_nodeID, seg_t** segPtrs, int segNum);
+
 //SRT process uses this function to receive a  sendseg_arg_t structure which contains a segment and its src node ID from the SNP process. 
 //Parameter network_conn is the TCP descriptor of the connection between the SRT process and the SNP process. 
 //When a segment is received, use seglost to determine if the segment should be discarded, also check the checksum.  
@@ -94,6 +110,10 @@ int seglost(seg_t* segPtr);
 //Use 1s complement for checksum calculation.
 unsigned short checksum(seg_t* segment);
 
+//This function rewrites the ack number of a segment that carries its checksum, and fixes up the checksum
+//from the old and the new ack number without summing the segment again (see checksum_update32()).
+void seg_setacknum(seg_t* segment, unsigned int ack_num);
+
 //Check the checksum in the segment,
 //return 1 if the checksum is valid,
 //return -1 if the checksum is invalid
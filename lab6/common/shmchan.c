@@ -0,0 +1,386 @@
+//FILE: common/shmchan.c
+//
+//Description: this file implements the shared memory channel used between the processes on the same node
+//
+//Date: October 17, 2026
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shmchan.h"
+
+//a ring record is a 4 byte body length followed by the body, padded to 4 bytes
+#define SHMCHAN_RECLEN(len) (4 + (((len) + 3) & ~3u))
+//number of times a waiting side polls the ring before it goes to sleep
+#define SHMCHAN_SPIN 2000
+//a sleeping side wakes up after this time in milliseconds to check if the other process is still there
+#define SHMCHAN_CHECK_INTERVAL 100
+
+//one direction of a channel, it lives in the shared memory object
+//tail is only written by the producer and head is only written by the consumer,
+//they are kept in different cache lines
+typedef struct shmring {
+    unsigned int tail;          //bytes written by the producer
+    char pad1[60];
+    unsigned int head;          //bytes consumed by the consumer
+    char pad2[60];
+    unsigned int dataSeq;       //futex word, bumped when data is added while the consumer sleeps
+    unsigned int dataWaiting;   //set when the consumer sleeps on dataSeq
+    unsigned int spaceSeq;      //futex word, bumped when space is freed while the producer sleeps
+    unsigned int spaceWaiting;  //set when the producer sleeps on spaceSeq
+    unsigned int closed;        //set when either side closes the channel
+    char pad3[44];
+    char data[SHM_RING_SIZE];
+} shm_ring_t;
+
+//layout of the shared memory object
+//ring[0] carries frames from the creator to the opener, ring[1] the other way
+typedef struct shmsegment {
+    shm_ring_t ring[2];
+} shm_segment_t;
+
+struct shmchan {
+    shm_segment_t* seg;
+    shm_ring_t* tx;             //ring this process sends on
+    shm_ring_t* rx;             //ring this process receives on
+    char name[SHMCHAN_NAME_LEN];
+    int created;                //1 if this process created the shared memory object
+    unsigned int pending;       //length of the record handed out by shmchan_next() and not released yet
+    char* bounce;               //copy of a frame that wraps around the end of the ring
+    unsigned int bounceSize;
+};
+
+static unsigned int shmchan_counter = 0;
+
+static void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void futex_wait(unsigned int* addr, unsigned int val, int ms)
+{
+    struct timespec timeout;
+    timeout.tv_sec = ms / 1000;
+    timeout.tv_nsec = (ms % 1000) * 1000000L;
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &timeout, NULL, 0);
+}
+
+static void futex_wake(unsigned int* addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+//check if the process at the other end of the local TCP connection is still there
+//return 1 if it is, otherwise return -1
+static int shmchan_peeralive(int conn)
+{
+    char c;
+    int n = recv(conn, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        return -1;
+    }
+    return 1;
+}
+
+//wait until *pos moves away from oldpos
+//the waiting side spins for a while, then sleeps on the futex word seq with the waiting flag set
+//return 1 if *pos may have moved, -1 if the channel is closed or the other process is gone
+static int shmchan_wait(shm_ring_t* ring, unsigned int* pos, unsigned int oldpos, unsigned int* seq, unsigned int* waiting, int conn)
+{
+    for (int i = 0; i < SHMCHAN_SPIN; i++) {
+        if (__atomic_load_n(pos, __ATOMIC_ACQUIRE) != oldpos) {
+            return 1;
+        }
+        cpu_relax();
+    }
+
+    unsigned int s = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    __atomic_store_n(waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(pos, __ATOMIC_ACQUIRE) == oldpos && !__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+        futex_wait(seq, s, SHMCHAN_CHECK_INTERVAL);
+    }
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+
+    if (__atomic_load_n(pos, __ATOMIC_ACQUIRE) != oldpos) {
+        return 1;
+    }
+    if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) || shmchan_peeralive(conn) < 0) {
+        return -1;
+    }
+    return 1;
+}
+
+//wake up the other side if it sleeps on the futex word seq
+static void shmchan_wake(unsigned int* seq, unsigned int* waiting)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(seq, 1, __ATOMIC_SEQ_CST);
+        futex_wake(seq);
+    }
+}
+
+//copy len bytes into the ring at position pos, wrapping around the end of the ring
+static void shmchan_copyin(shm_ring_t* ring, unsigned int pos, const void* src, unsigned int len)
+{
+    unsigned int idx = pos & (SHM_RING_SIZE - 1);
+    unsigned int first = SHM_RING_SIZE - idx;
+    if (first >= len) {
+        memcpy(ring->data + idx, src, len);
+    }
+    else {
+        memcpy(ring->data + idx, src, first);
+        memcpy(ring->data, (const char*)src + first, len - first);
+    }
+}
+
+//copy len bytes out of the ring at position pos, wrapping around the end of the ring
+static void shmchan_copyout(shm_ring_t* ring, unsigned int pos, void* dest, unsigned int len)
+{
+    unsigned int idx = pos & (SHM_RING_SIZE - 1);
+    unsigned int first = SHM_RING_SIZE - idx;
+    if (first >= len) {
+        memcpy(dest, ring->data + idx, len);
+    }
+    else {
+        memcpy(dest, ring->data + idx, first);
+        memcpy((char*)dest + first, ring->data, len - first);
+    }
+}
+
+//map the shared memory object and set up the channel handle
+static shm_chan_t* shmchan_map(int fd, const char* name, int created)
+{
+    void* addr = mmap(NULL, sizeof(shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("shmchan: mmap error");
+        return NULL;
+    }
+
+    shm_chan_t* chan = (shm_chan_t*)malloc(sizeof(shm_chan_t));
+    chan->seg = (shm_segment_t*)addr;
+    chan->tx = &chan->seg->ring[created ? 0 : 1];
+    chan->rx = &chan->seg->ring[created ? 1 : 0];
+    strncpy(chan->name, name, SHMCHAN_NAME_LEN - 1);
+    chan->name[SHMCHAN_NAME_LEN - 1] = '\0';
+    chan->created = created;
+    chan->pending = 0;
+    chan->bounce = NULL;
+    chan->bounceSize = 0;
+    return chan;
+}
+
+//This function creates a new shared memory channel. It is called by the connecting side of a local connection.
+//The name of the shared memory object is stored in name, the other side opens the channel with this name.
+//Return the channel if it is created successfully, otherwise return NULL.
+shm_chan_t* shmchan_create(char* name)
+{
+    unsigned int id = __atomic_add_fetch(&shmchan_counter, 1, __ATOMIC_RELAXED);
+    snprintf(name, SHMCHAN_NAME_LEN, "/dartnet-%d-%u", (int)getpid(), id);
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shmchan: shm_open error");
+        return NULL;
+    }
+    // the new object is zero filled, which is an empty ring in both directions
+    if (ftruncate(fd, sizeof(shm_segment_t)) < 0) {
+        perror("shmchan: ftruncate error");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    shm_chan_t* chan = shmchan_map(fd, name, 1);
+    if (chan == NULL) {
+        shm_unlink(name);
+    }
+    return chan;
+}
+
+//This function opens the shared memory channel with the given name. It is called by the accepting side of a local connection.
+//The shared memory object name is removed after it is opened, so it goes away when both sides are done.
+//Return the channel if it is opened successfully, otherwise return NULL.
+shm_chan_t* shmchan_open(const char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shmchan: shm_open error");
+        return NULL;
+    }
+    shm_unlink(name);
+    return shmchan_map(fd, name, 0);
+}
+
+//This function sends frameNum frames over the channel.
+//The body of frame i is gathered from iovcnt[i] buffers, which are the next iovcnt[i] entries of iov.
+//It waits for free space in the ring if the ring is full.
+//Only one thread may call this function on a channel at a time.
+//Parameter conn is the local TCP connection of the channel, it is checked while waiting.
+//Return 1 if all the frames are sent successfully, otherwise return -1.
+int shmchan_send(shm_chan_t* chan, int conn, const struct iovec* iov, const int* iovcnt, int frameNum)
+{
+    shm_ring_t* ring = chan->tx;
+    unsigned int tail = ring->tail;
+    const struct iovec* body = iov;
+
+    for (int i = 0; i < frameNum; i++) {
+        unsigned int len = 0;
+        for (int j = 0; j < iovcnt[i]; j++) {
+            len += body[j].iov_len;
+        }
+        unsigned int reclen = SHMCHAN_RECLEN(len);
+        if (reclen > SHM_RING_SIZE) {
+            return -1;
+        }
+
+        // wait for space, the frames written so far are handed to the consumer first
+        unsigned int head;
+        while (tail - (head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) + reclen > SHM_RING_SIZE) {
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            shmchan_wake(&ring->dataSeq, &ring->dataWaiting);
+            if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)
+                || shmchan_wait(ring, &ring->head, head, &ring->spaceSeq, &ring->spaceWaiting, conn) < 0) {
+                return -1;
+            }
+        }
+
+        shmchan_copyin(ring, tail, &len, 4);
+        unsigned int pos = tail + 4;
+        for (int j = 0; j < iovcnt[i]; j++) {
+            shmchan_copyin(ring, pos, body[j].iov_base, body[j].iov_len);
+            pos += body[j].iov_len;
+        }
+        body += iovcnt[i];
+        tail += reclen;
+    }
+
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    shmchan_wake(&ring->dataSeq, &ring->dataWaiting);
+    if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    return 1;
+}
+
+//give the space of the record handed out by the last shmchan_next() back to the producer
+static void shmchan_release(shm_chan_t* chan)
+{
+    if (chan->pending > 0) {
+        shm_ring_t* ring = chan->rx;
+        __atomic_store_n(&ring->head, ring->head + chan->pending, __ATOMIC_RELEASE);
+        shmchan_wake(&ring->spaceSeq, &ring->spaceWaiting);
+        chan->pending = 0;
+    }
+}
+
+//wait for the next record in the receive ring
+//return the length of the frame body, or -1 if the channel is closed
+static int shmchan_waitrecord(shm_chan_t* chan, int conn)
+{
+    shm_ring_t* ring = chan->rx;
+    unsigned int head = ring->head;
+
+    while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head) {
+        if (shmchan_wait(ring, &ring->tail, head, &ring->dataSeq, &ring->dataWaiting, conn) < 0) {
+            return -1;
+        }
+    }
+
+    unsigned int len;
+    shmchan_copyout(ring, head, &len, 4);
+    return len;
+}
+
+//This function receives the next frame from the channel.
+//At most maxlen bytes of the frame body are copied into body, the rest of the body is discarded.
+//Parameter conn is the local TCP connection of the channel, it is checked while waiting.
+//Return the length of the frame body, or -1 if the channel is closed.
+int shmchan_recv(shm_chan_t* chan, int conn, void* body, int maxlen)
+{
+    shmchan_release(chan);
+    int len = shmchan_waitrecord(chan, conn);
+    if (len < 0) {
+        return -1;
+    }
+
+    shm_ring_t* ring = chan->rx;
+    shmchan_copyout(ring, ring->head + 4, body, len < maxlen ? len : maxlen);
+    chan->pending = SHMCHAN_RECLEN(len);
+    shmchan_release(chan);
+    return len;
+}
+
+//This function receives the next frame from the channel without copying it.
+//A pointer to the frame body in the ring is stored in body. The frame stays in the ring until the next
+//shmchan_next() or shmchan_recv() call on the channel, so the pointer is valid until then.
+//Parameter conn is the local TCP connection of the channel, it is checked while waiting.
+//Return the length of the frame body, or -1 if the channel is closed.
+int shmchan_next(shm_chan_t* chan, int conn, void** body)
+{
+    shmchan_release(chan);
+    int len = shmchan_waitrecord(chan, conn);
+    if (len < 0) {
+        return -1;
+    }
+
+    shm_ring_t* ring = chan->rx;
+    unsigned int idx = (ring->head + 4) & (SHM_RING_SIZE - 1);
+    if (idx + len <= SHM_RING_SIZE) {
+        *body = ring->data + idx;
+    }
+    else {
+        // the body wraps around the end of the ring, hand out a contiguous copy
+        if (chan->bounceSize < len) {
+            chan->bounce = (char*)realloc(chan->bounce, len);
+            chan->bounceSize = len;
+        }
+        shmchan_copyout(ring, ring->head + 4, chan->bounce, len);
+        *body = chan->bounce;
+    }
+    chan->pending = SHMCHAN_RECLEN(len);
+    return len;
+}
+
+//This function closes the channel. The other side sees the channel closed once it has received all the frames in the ring.
+//The shared memory mapping is released.
+void shmchan_close(shm_chan_t* chan)
+{
+    if (chan == NULL) {
+        return;
+    }
+
+    // tell the other side, whichever direction it is waiting on
+    for (int i = 0; i < 2; i++) {
+        shm_ring_t* ring = &chan->seg->ring[i];
+        __atomic_store_n(&ring->closed, 1, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&ring->dataSeq, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&ring->dataSeq);
+        __atomic_add_fetch(&ring->spaceSeq, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&ring->spaceSeq);
+    }
+
+    if (chan->created) {
+        // the other side may never have opened it
+        shm_unlink(chan->name);
+    }
+    munmap(chan->seg, sizeof(shm_segment_t));
+    free(chan->bounce);
+    free(chan);
+}
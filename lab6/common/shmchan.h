@@ -0,0 +1,63 @@
+//FILE: common/shmchan.h
+//
+//Description: this file defines the shared memory channel used between the processes on the same node
+//(SRT process <-> SNP process and SNP process <-> ON process).
+//
+//A channel is a POSIX shared memory object holding two lock-free single-producer/single-consumer
+//rings, one for each direction. Frames are copied into the ring by the sender and out of the ring
+//by the receiver, no system call is made unless the other side is asleep. A side that has to wait
+//spins for a short time and then sleeps on a futex in the shared memory object.
+//
+//The channel is set up over the local TCP connection (see common/ipc.h), which is kept open to
+//detect that the other process is gone.
+//
+//Date: October 17, 2026
+
+#ifndef SHMCHAN_H
+#define SHMCHAN_H
+
+#include <sys/uio.h>
+#include "constants.h"
+
+//max length of a shared memory object name
+#define SHMCHAN_NAME_LEN 64
+
+//shared memory channel handle, it is local to a process
+typedef struct shmchan shm_chan_t;
+
+//This function creates a new shared memory channel. It is called by the connecting side of a local connection.
+//The name of the shared memory object is stored in name, the other side opens the channel with this name.
+//Return the channel if it is created successfully, otherwise return NULL.
+shm_chan_t* shmchan_create(char* name);
+
+//This function opens the shared memory channel with the given name. It is called by the accepting side of a local connection.
+//The shared memory object name is removed after it is opened, so it goes away when both sides are done.
+//Return the channel if it is opened successfully, otherwise return NULL.
+shm_chan_t* shmchan_open(const char* name);
+
+//This function sends frameNum frames over the channel.
+//The body of frame i is gathered from iovcnt[i] buffers, which are the next iovcnt[i] entries of iov.
+//It waits for free space in the ring if the ring is full.
+//Only one thread may call this function on a channel at a time.
+//Parameter conn is the local TCP connection of the channel, it is checked while waiting.
+//Return 1 if all the frames are sent successfully, otherwise return -1.
+int shmchan_send(shm_chan_t* chan, int conn, const struct iovec* iov, const int* iovcnt, int frameNum);
+
+//This function receives the next frame from the channel.
+//At most maxlen bytes of the frame body are copied into body, the rest of the body is discarded.
+//Parameter conn is the local TCP connection of the channel, it is checked while waiting.
+//Return the length of the frame body, or -1 if the channel is closed.
+int shmchan_recv(shm_chan_t* chan, int conn, void* body, int maxlen);
+
+//This function receives the next frame from the channel without copying it.
+//A pointer to the frame body in the ring is stored in body. The frame stays in the ring until the next
+//shmchan_next() or shmchan_recv() call on the channel, so the pointer is valid until then.
+//Parameter conn is the local TCP connection of the channel, it is checked while waiting.
+//Return the length of the frame body, or -1 if the channel is closed.
+int shmchan_next(shm_chan_t* chan, int conn, void** body);
+
+//This function closes the channel. The other side sees the channel closed once it has received all the frames in the ring.
+//The shared memory mapping is released.
+void shmchan_close(shm_chan_t* chan);
+
+#endif
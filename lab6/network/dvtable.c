@@ -1,4 +1,5 @@
 
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,12 +7,12 @@
 
 #include "../common/constants.h"
 #include "../topology/topology.h"
+#include "../common/config.h"
 #include "dvtable.h"
 
 //This function creates a dvtable(distance vector table) dynamically.
-//A distance vector table contains the n+1 entries, where n is the number of the neighbors of this node, and the rest one is for this node itself. 
-//Each entry in distance vector table is a dv_t structure which contains a source node ID and an array of N dv_entry_t structures where N is the number of all the nodes in the overlay.
-//Each dv_entry_t contains a destination node address the the cost from the source node to this destination node.
+//A distance vector table contains the n+1 rows, where n is the number of the neighbors of this node, and the rest one is for this node itself. 
+//Each row is a distance vector from a source node to all the N nodes in the overlay.
 //The dvtable is initialized in this function.
 //The link costs from this node to its neighbors are initialized using direct link cost retrived from topology.dat. 
 //Other link costs are initialized to INFINITE_COST.
@@ -19,30 +20,72 @@
 dv_t* dvtable_create()
 {
     int nbrNum = topology_getNbrNum();
-    dv_t *dv_table = (dv_t *)malloc(sizeof(dv_t) * (nbrNum + 1));
-    
-    dv_table[0].nodeID = topology_getMyNodeID();
-
     int nodeNum = topology_getNodeNum();
-    dv_table[0].dvEntry = (dv_entry_t *)malloc(sizeof(dv_entry_t) * nodeNum);
-    
-    int *node_array = topology_getNodeArray();
-    for (int i = 0; i < nodeNum; i++){
-        dv_table[0].dvEntry[i].nodeID = node_array[i];
-        dv_table[0].dvEntry[i].cost = topology_getCost(dv_table[0].nodeID, node_array[i]);
+    int myNodeID = topology_getMyNodeID();
+    int rowAlign = DVTABLE_ROW_ALIGN / sizeof(unsigned int);
+
+    dv_t *dv_table = (dv_t *)malloc(sizeof(dv_t));
+    dv_table->rowNum = nbrNum + 1;
+    dv_table->nodeNum = nodeNum;
+    dv_table->stride = (nodeNum + rowAlign - 1) / rowAlign * rowAlign;
+    if (dv_table->stride == 0){
+        dv_table->stride = rowAlign;
+    }
+    dv_table->rowNodeIDs = (int *)malloc(sizeof(int) * dv_table->rowNum);
+    dv_table->nodeIDs = topology_getNodeArray();
+    dv_table->nodeRows = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    void *matrix;
+    if (posix_memalign(&matrix, DVTABLE_ROW_ALIGN, sizeof(unsigned int) * dv_table->rowNum * dv_table->stride) != 0){
+        printf("Cannot allocate the distance vector table!\n");
+        exit(1);
     }
+    dv_table->cost = (unsigned int *)matrix;
+    dv_table->nextNodeIDs = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    dv_table->newCost = (unsigned int *)malloc(sizeof(unsigned int) * (dv_table->stride + 1));
+    dv_table->newNext = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    dv_table->paths = (int *)malloc(sizeof(int) * ((size_t)nodeNum * ECMP_MAX_PATHS + 1));
+    dv_table->newPaths = (int *)malloc(sizeof(int) * ECMP_MAX_PATHS);
+    dv_table->backups = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    dv_table->backupsChanged = 0;
+    dv_table->infinity = config_getInfinity();
+    dv_table->linkCost = (unsigned int *)malloc(sizeof(unsigned int) * dv_table->rowNum);
+    dv_table->changedFlags = (char *)calloc(nodeNum + 1, sizeof(char));
+    dv_table->changedCols = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    dv_table->changedNum = 0;
     
+    for (int j = 0; j < nodeNum; j++){
+        dv_table->nodeRows[j] = -1;
+    }
     int *nbr_array = topology_getNbrArray();
-    for (int i = 1; i < nbrNum + 1; i++){
-        dv_table[i].nodeID = nbr_array[i - 1];
-        dv_table[i].dvEntry = (dv_entry_t *)malloc(sizeof(dv_entry_t) * nodeNum);
-        for (int j = 0; j < nodeNum; j++){
-            dv_table[i].dvEntry[j].nodeID = node_array[j];
-            dv_table[i].dvEntry[j].cost = INFINITE_COST;
+    for (int i = 0; i < dv_table->rowNum; i++){
+        dv_table->rowNodeIDs[i] = i == 0 ? myNodeID : nbr_array[i - 1];
+        int idx = topology_getNodeIndex(dv_table->rowNodeIDs[i]);
+        if (idx >= 0 && dv_table->nodeRows[idx] < 0){
+            dv_table->nodeRows[idx] = i;
+        }
+        unsigned int *row = DVTABLE_ROW(dv_table, i);
+        for (int j = 0; j < dv_table->stride; j++){
+            row[j] = INFINITE_COST;
+        }
+        // a neighbor reaches itself at cost 0 before it has sent its distance vector
+        if (idx >= 0){
+            row[idx] = 0;
         }
     }
-    free(node_array);
     free(nbr_array);
+    
+    unsigned int *myRow = DVTABLE_ROW(dv_table, 0);
+    for (int j = 0; j < nodeNum; j++){
+        myRow[j] = topology_getCost(myNodeID, dv_table->nodeIDs[j]);
+        dv_table->nextNodeIDs[j] = -1;
+        dv_table->backups[j] = -1;
+        if (dv_table->nodeRows[j] > 0 && myRow[j] < INFINITE_COST){
+            dv_table->nextNodeIDs[j] = dv_table->nodeIDs[j];
+        }
+        for (int k = 0; k < ECMP_MAX_PATHS; k++){
+            dv_table->paths[(size_t)j * ECMP_MAX_PATHS + k] = k == 0 ? dv_table->nextNodeIDs[j] : -1;
+        }
+    }
     return dv_table;
 }
 
@@ -50,31 +93,66 @@ dv_t* dvtable_create()
 //It frees all the dynamically allocated memory for the dvtable.
 void dvtable_destroy(dv_t* dvtable)
 {
-    int nbrNum = topology_getNbrNum();
-    for (int i = 0; i < nbrNum + 1; i++){
-        free(dvtable[i].dvEntry);
-    }
+    free(dvtable->rowNodeIDs);
+    free(dvtable->nodeIDs);
+    free(dvtable->nodeRows);
+    free(dvtable->cost);
+    free(dvtable->nextNodeIDs);
+    free(dvtable->newCost);
+    free(dvtable->newNext);
+    free(dvtable->paths);
+    free(dvtable->newPaths);
+    free(dvtable->backups);
+    free(dvtable->linkCost);
+    free(dvtable->changedFlags);
+    free(dvtable->changedCols);
     free(dvtable);
 }
 
+//This function returns the row of the distance vector of the given node, 0 for this node.
+//If the node is neither this node nor a neighbor, return -1.
+int dvtable_getrow(dv_t* dvtable, int nodeID)
+{
+    int idx = topology_getNodeIndex(nodeID);
+    if (idx < 0){
+        return -1;
+    }
+    return dvtable->nodeRows[idx];
+}
+
 //This function sets the link cost between two nodes in dvtable.
 //If those two nodes are found in the table and the link cost is set, return 1.
 //Otherwise, return -1.
 int dvtable_setcost(dv_t* dvtable,int fromNodeID,int toNodeID, unsigned int cost)
 {
-    int nbrNum = topology_getNbrNum();
-    int nodeNum = topology_getNodeNum();
-    for (int i = 0; i < nbrNum + 1; i++){
-        if (dvtable[i].nodeID == fromNodeID){
-            for (int j = 0; j < nodeNum; j++){
-                if (dvtable[i].dvEntry[j].nodeID == toNodeID){
-                    dvtable[i].dvEntry[j].cost = cost;
-                    return 1;
-                }
-            }
-        }
+    int row = dvtable_getrow(dvtable, fromNodeID);
+    int col = topology_getNodeIndex(toNodeID);
+    if (row < 0 || col < 0){
+        return -1;
+    }
+    DVTABLE_ROW(dvtable, row)[col] = cost;
+    return 1;
+}
+
+//This function sets all the costs in the distance vector of the given neighbor to INFINITE_COST, except its cost to itself.
+//Return 1 if the neighbor is found, otherwise return -1.
+int dvtable_clearrow(dv_t* dvtable, int nodeID)
+{
+    int row = dvtable_getrow(dvtable, nodeID);
+    if (row <= 0){
+        return -1;
+    }
+    unsigned int* cost = DVTABLE_ROW(dvtable, row);
+    for (int j = 0; j < dvtable->nodeNum; j++){
+        cost[j] = INFINITE_COST;
     }
-    return -1;
+    // as in dvtable_create(), the neighbor reaches itself at cost 0 until it sends its distance vector again,
+    // the updates only carry the costs that changed and never this one
+    int idx = topology_getNodeIndex(nodeID);
+    if (idx >= 0){
+        cost[idx] = 0;
+    }
+    return 1;
 }
 
 //This function returns the link cost between two nodes in dvtable
@@ -82,31 +160,223 @@ int dvtable_setcost(dv_t* dvtable,int fromNodeID,int toNodeID, unsigned int cost
 //otherwise, return INFINITE_COST.
 unsigned int dvtable_getcost(dv_t* dvtable, int fromNodeID, int toNodeID)
 {
-    int nbrNum = topology_getNbrNum();
-    int nodeNum = topology_getNodeNum();
-    for (int i = 0; i < nbrNum + 1; i++){
-        if (dvtable[i].nodeID == fromNodeID){
-            for (int j = 0; j < nodeNum; j++){
-                if (dvtable[i].dvEntry[j].nodeID == toNodeID){
-                    return dvtable[i].dvEntry[j].cost;
-                }
+    int row = dvtable_getrow(dvtable, fromNodeID);
+    int col = topology_getNodeIndex(toNodeID);
+    if (row < 0 || col < 0){
+        return INFINITE_COST;
+    }
+    return DVTABLE_ROW(dvtable, row)[col];
+}
+
+//fill dvtable->linkCost with the direct link cost to the neighbor of each row
+static void dvtable_linkcosts(dv_t* dvtable, nbr_cost_entry_t* nct)
+{
+    for (int i = 1; i < dvtable->rowNum; i++){
+        dvtable->linkCost[i] = nbrcosttable_getcost(nct, dvtable->rowNodeIDs[i]);
+    }
+}
+
+//set the cost and the next hop of this node to the node of column j
+//the other neighbors that give the same cost are kept as equal-cost next hops after the next hop, dvtable->linkCost must be filled
+//the routing table entry is updated if the next hops change, and the column is added to the changed columns
+//return 1 if the cost or the next hops have changed, otherwise return 0
+static int dvtable_apply(dv_t* dvtable, routingtable_t* routingtable, int j, unsigned int cost, int via)
+{
+    unsigned int *myRow = DVTABLE_ROW(dvtable, 0);
+    int *paths = dvtable->paths + (size_t)j * ECMP_MAX_PATHS;
+    int *newPaths = dvtable->newPaths;
+    if (cost >= dvtable->infinity){
+        cost = INFINITE_COST;
+        via = -1;
+    }
+    int pathNum = 0;
+    if (via >= 0){
+        newPaths[pathNum++] = via;
+        for (int i = 1; i < dvtable->rowNum && pathNum < ECMP_MAX_PATHS; i++){
+            unsigned int nbrCost = DVTABLE_ROW(dvtable, i)[j];
+            if (dvtable->rowNodeIDs[i] != via && dvtable->linkCost[i] < dvtable->infinity && nbrCost < dvtable->infinity
+                && dvtable->linkCost[i] + nbrCost == cost){
+                newPaths[pathNum++] = dvtable->rowNodeIDs[i];
             }
         }
     }
-    return INFINITE_COST;
+    for (int k = pathNum; k < ECMP_MAX_PATHS; k++){
+        newPaths[k] = -1;
+    }
+    int pathsChanged = memcmp(paths, newPaths, sizeof(int) * ECMP_MAX_PATHS) != 0;
+    if (cost == myRow[j] && !pathsChanged){
+        return 0;
+    }
+    myRow[j] = cost;
+    if (pathsChanged){
+        memcpy(paths, newPaths, sizeof(int) * ECMP_MAX_PATHS);
+        dvtable->nextNodeIDs[j] = via;
+        if (via < 0){
+            routingtable_removenode(routingtable, dvtable->nodeIDs[j]);
+        }
+        else {
+            routingtable_setnextnodes(routingtable, dvtable->nodeIDs[j], newPaths, pathNum);
+        }
+    }
+    if (!dvtable->changedFlags[j]){
+        dvtable->changedFlags[j] = 1;
+        dvtable->changedCols[dvtable->changedNum++] = j;
+    }
+    return 1;
+}
+
+//set the backup next hop of this node to the node of column j, the loop-free alternate with the lowest cost through it
+//that is not one of the equal-cost next hops, dvtable->linkCost must be filled and row 0 must be up to date
+//the routing table entry is updated and backupsChanged is set if the backup changes
+static void dvtable_setbackup(dv_t* dvtable, routingtable_t* routingtable, int j, int myIdx)
+{
+    unsigned int myCost = DVTABLE_ROW(dvtable, 0)[j];
+    int backup = -1;
+    if (myCost < dvtable->infinity){
+        unsigned int best = INFINITE_COST;
+        for (int i = 1; i < dvtable->rowNum; i++){
+            unsigned int linkCost = dvtable->linkCost[i];
+            unsigned int nbrCost = DVTABLE_ROW(dvtable, i)[j];
+            if (linkCost >= dvtable->infinity || nbrCost >= dvtable->infinity || dvtable_isnexthop(dvtable, dvtable->rowNodeIDs[i], j)){
+                continue;
+            }
+            unsigned int nbrCostToMe = DVTABLE_ROW(dvtable, i)[myIdx];
+            if (nbrCostToMe > linkCost){
+                nbrCostToMe = linkCost;
+            }
+            if (DVTABLE_LOOPFREE(nbrCost, nbrCostToMe, myCost) && linkCost + nbrCost < best){
+                best = linkCost + nbrCost;
+                backup = dvtable->rowNodeIDs[i];
+            }
+        }
+    }
+    if (backup == dvtable->backups[j]){
+        return;
+    }
+    dvtable->backups[j] = backup;
+    dvtable->backupsChanged = 1;
+    routingtable_setbackupnode(routingtable, dvtable->nodeIDs[j], backup);
+}
+
+//This function recomputes the distance vector of this node (row 0) from the distance vectors of all the neighbors
+//and the direct link costs in nct (Bellman-Ford): the cost to a node is the min over the neighbors of the link cost
+//to the neighbor plus the neighbor's cost to the node. A cost that reaches the infinity of the table is set to INFINITE_COST.
+//On a tie the current next hop is kept as the first next hop, and all the neighbors giving the same cost are kept as
+//equal-cost next hops, up to ECMP_MAX_PATHS. The routing table entries of the nodes whose next hops changed are updated,
+//unreachable nodes are removed from the routing table. The columns that changed are added to the changed columns.
+//Return the number of nodes whose cost or next hops changed.
+int dvtable_recompute(dv_t* dvtable, nbr_cost_entry_t* nct, routingtable_t* routingtable)
+{
+    int nodeNum = dvtable->nodeNum;
+    unsigned int *best = dvtable->newCost;
+    int *via = dvtable->newNext;
+    int *next = dvtable->nextNodeIDs;
+    for (int j = 0; j < nodeNum; j++){
+        best[j] = INFINITE_COST;
+        via[j] = -1;
+    }
+    
+    // relax one neighbor's row at a time, the rows are scanned in order
+    dvtable_linkcosts(dvtable, nct);
+    for (int i = 1; i < dvtable->rowNum; i++){
+        int nbr = dvtable->rowNodeIDs[i];
+        unsigned int linkCost = dvtable->linkCost[i];
+        if (linkCost >= dvtable->infinity){
+            continue;
+        }
+        unsigned int *row = DVTABLE_ROW(dvtable, i);
+        for (int j = 0; j < nodeNum; j++){
+            unsigned int cost = linkCost + row[j];
+            if (row[j] < dvtable->infinity && (cost < best[j] || (cost == best[j] && next[j] == nbr))){
+                best[j] = cost;
+                via[j] = nbr;
+            }
+        }
+    }
+    
+    int myIdx = topology_getNodeIndex(dvtable->rowNodeIDs[0]);
+    int changed = 0;
+    for (int j = 0; j < nodeNum; j++){
+        if (j != myIdx){
+            changed += dvtable_apply(dvtable, routingtable, j, best[j], via[j]);
+            dvtable_setbackup(dvtable, routingtable, j, myIdx);
+        }
+    }
+    return changed;
+}
+
+//This function recomputes the cost and the next hop of this node to the nodes of the colNum given columns only,
+//in the same way as dvtable_recompute(). It is used when only these columns of the neighbors' distance vectors have changed.
+//Return the number of nodes whose cost or next hops changed.
+int dvtable_recomputecols(dv_t* dvtable, nbr_cost_entry_t* nct, routingtable_t* routingtable, const int* cols, int colNum)
+{
+    int myIdx = topology_getNodeIndex(dvtable->rowNodeIDs[0]);
+    int changed = 0;
+    // a neighbor's cost to this node changes which neighbors are loop-free alternates to every node
+    int allBackups = 0;
+    dvtable_linkcosts(dvtable, nct);
+    for (int k = 0; k < colNum; k++){
+        int j = cols[k];
+        if (j == myIdx){
+            allBackups = 1;
+            continue;
+        }
+        unsigned int best = INFINITE_COST;
+        int via = -1;
+        for (int i = 1; i < dvtable->rowNum; i++){
+            unsigned int linkCost = dvtable->linkCost[i];
+            unsigned int nbrCost = DVTABLE_ROW(dvtable, i)[j];
+            if (linkCost >= dvtable->infinity || nbrCost >= dvtable->infinity){
+                continue;
+            }
+            unsigned int cost = linkCost + nbrCost;
+            if (cost < best || (cost == best && dvtable->nextNodeIDs[j] == dvtable->rowNodeIDs[i])){
+                best = cost;
+                via = dvtable->rowNodeIDs[i];
+            }
+        }
+        changed += dvtable_apply(dvtable, routingtable, j, best, via);
+        dvtable_setbackup(dvtable, routingtable, j, myIdx);
+    }
+    for (int j = 0; allBackups && j < dvtable->nodeNum; j++){
+        if (j != myIdx){
+            dvtable_setbackup(dvtable, routingtable, j, myIdx);
+        }
+    }
+    return changed;
+}
+
+//This function returns 1 if the given neighbor is one of the equal-cost next hops of this node to the node of column j.
+int dvtable_isnexthop(dv_t* dvtable, int nbrID, int j)
+{
+    const int *paths = dvtable->paths + (size_t)j * ECMP_MAX_PATHS;
+    for (int k = 0; k < ECMP_MAX_PATHS && paths[k] >= 0; k++){
+        if (paths[k] == nbrID){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//This function empties the list of changed columns, it is called after the changes have been advertised.
+void dvtable_clearchanged(dv_t* dvtable)
+{
+    for (int k = 0; k < dvtable->changedNum; k++){
+        dvtable->changedFlags[dvtable->changedCols[k]] = 0;
+    }
+    dvtable->changedNum = 0;
 }
 
 //This function prints out the contents of a dvtable.
 void dvtable_print(dv_t* dvtable)
 {
-    int nbrNum = topology_getNbrNum();
-    int nodeNum = topology_getNodeNum();
     int myNodeID = topology_getMyNodeID();
     printf("This is distance vector table of %d:\n", myNodeID);
     printf("fromNode  toNode  cost\n");
-    for (int i = 0; i < nbrNum + 1; i++){
-        for (int j = 0; j < nodeNum; j++){
-            printf("%d \t %d \t %u\n", dvtable[i].nodeID, dvtable[i].dvEntry[j].nodeID, dvtable[i].dvEntry[j].cost);
+    for (int i = 0; i < dvtable->rowNum; i++){
+        unsigned int *row = DVTABLE_ROW(dvtable, i);
+        for (int j = 0; j < dvtable->nodeNum; j++){
+            printf("%d \t %d \t %u\n", dvtable->rowNodeIDs[i], dvtable->nodeIDs[j], row[j]);
         }
     }
 }
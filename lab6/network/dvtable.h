@@ -10,25 +10,47 @@
 #define DVTABLE_H
 
 #include "../common/pkt.h"
+#include "nbrcosttable.h"
+#include "routingtable.h"
 
-//dv_entry_t structure definition
-typedef struct distancevectorentry {
-	int nodeID;		//destnation nodeID	
-	unsigned int cost;	//cost to the destination
-} dv_entry_t;
+//rows of the cost matrix start on a cache line boundary
+#define DVTABLE_ROW_ALIGN 64
 
-
-//A distance vector table contains the n+1 dv_t entries, where n is the number of the neighbors of this node, and the rest one is for this node itself. 
+//A distance vector table contains the n+1 distance vectors (rows), where n is the number of the neighbors of this node, and the rest one is for this node itself. 
+//Row 0 is the distance vector of this node, row i (i >= 1) is the distance vector of the i-th neighbor in topology_getNbrArray() order.
+//Column j is the j-th node in topology_getNodeArray() order, so the column of a node is topology_getNodeIndex(nodeID).
+//All the costs are kept in one contiguous matrix. Each row is padded to a multiple of DVTABLE_ROW_ALIGN bytes
+//and starts on a DVTABLE_ROW_ALIGN boundary, so a row can be scanned with vector instructions.
 typedef struct distancevector {
-	int nodeID;		//source nodeID
-	dv_entry_t* dvEntry;	//an array of N dv_entry_ts, each of which contains the destination node ID and the cost to the destination from the source node. N is the total number of nodes in the overlay.
+	int rowNum;		//number of rows, n+1
+	int nodeNum;		//number of columns, N is the total number of nodes in the overlay
+	int stride;		//distance between two rows in the cost matrix, in costs
+	int* rowNodeIDs;	//source node ID of each row
+	int* nodeIDs;		//destination node ID of each column
+	int* nodeRows;		//row of each node by column, -1 if the node is neither this node nor a neighbor
+	unsigned int* cost;	//the cost matrix, the cost from the source node of row i to the destination node of column j is cost[i * stride + j]
+	int* nextNodeIDs;	//next hop of this node to the node of each column, -1 if the node is unreachable
+	int* paths;		//equal-cost next hops of this node to the node of each column, ECMP_MAX_PATHS per column,
+				//paths[j * ECMP_MAX_PATHS] is nextNodeIDs[j], the unused ones are -1
+	int* newPaths;		//scratch next hops used by dvtable_recompute()
+	int* backups;		//loop-free alternate next hop of this node to the node of each column, -1 if there is none
+	int backupsChanged;	//set when a backup next hop changed, cleared by the caller when it publishes the FIB
+	unsigned int* newCost;	//scratch row used by dvtable_recompute()
+	int* newNext;		//scratch next hops used by dvtable_recompute()
+	unsigned int infinity;	//a route whose cost reaches infinity is unreachable, see ROUTE_INFINITY in constants.h
+	unsigned int* linkCost;	//scratch direct link cost to the neighbor of each row
+	char* changedFlags;	//set for the columns of row 0 that changed since the last route update
+	int* changedCols;	//the columns of row 0 that changed since the last route update, in the order they changed
+	int changedNum;		//number of changed columns
 } dv_t;
 
+//DVTABLE_ROW is the distance vector (an array of nodeNum costs) in row i
+#define DVTABLE_ROW(dvtable, i) ((dvtable)->cost + (size_t)(i) * (dvtable)->stride)
+
 
 //This function creates a dvtable(distance vector table) dynamically.
-//A distance vector table contains the n+1 entries, where n is the number of the neighbors of this node, and the rest one is for this node itself. 
-//Each entry in distance vector table is a dv_t structure which contains a source node ID and an array of N dv_entry_t structures where N is the number of all the nodes in the overlay.
-//Each dv_entry_t contains a destination node address the the cost from the source node to this destination node.
+//A distance vector table contains the n+1 rows, where n is the number of the neighbors of this node, and the rest one is for this node itself. 
+//Each row is a distance vector from a source node to all the N nodes in the overlay.
 //The dvtable is initialized in this function.
 //The link costs from this node to its neighbors are initialized using direct link cost retrived from topology.dat. 
 //Other link costs are initialized to INFINITE_COST.
@@ -39,16 +61,59 @@ dv_t* dvtable_create();
 //It frees all the dynamically allocated memory for the dvtable.
 void dvtable_destroy(dv_t* dvtable);
 
+//This function returns the row of the distance vector of the given node, 0 for this node.
+//If the node is neither this node nor a neighbor, return -1.
+int dvtable_getrow(dv_t* dvtable, int nodeID);
+
 //This function sets the link cost between two nodes in dvtable.
 //If those two nodes are found in the table and the link cost is set, return 1.
 //Otherwise, return -1.
 int dvtable_setcost(dv_t* dvtable,int fromNodeID,int toNodeID, unsigned int cost);
 
+//This function sets all the costs in the distance vector of the given neighbor to INFINITE_COST, except its cost to itself,
+//which stays 0. It is used when the link to the neighbor goes down, so that its old routes are not used when the link comes back up.
+//Return 1 if the neighbor is found, otherwise return -1.
+int dvtable_clearrow(dv_t* dvtable, int nodeID);
+
 //This function returns the link cost between two nodes in dvtable
 //If those two nodes are found in dvtable, return the link cost. 
 //otherwise, return INFINITE_COST.
 unsigned int dvtable_getcost(dv_t* dvtable, int fromNodeID, int toNodeID);
 
+//This function recomputes the distance vector of this node (row 0) from the distance vectors of all the neighbors
+//and the direct link costs in nct (Bellman-Ford): the cost to a node is the min over the neighbors of the link cost
+//to the neighbor plus the neighbor's cost to the node. A cost that reaches the infinity of the table is set to INFINITE_COST.
+//On a tie the current next hop is kept as the first next hop, and all the neighbors giving the same cost are kept as
+//equal-cost next hops, up to ECMP_MAX_PATHS. The routing table entries of the nodes whose next hops changed are updated,
+//unreachable nodes are removed from the routing table. The columns that changed are added to the changed columns.
+//The backup next hop of each node is recomputed as well (see DVTABLE_LOOPFREE), backupsChanged is set if one changed.
+//Return the number of nodes whose cost or next hops changed.
+int dvtable_recompute(dv_t* dvtable, nbr_cost_entry_t* nct, routingtable_t* routingtable);
+
+//This function recomputes the cost and the next hop of this node to the nodes of the colNum given columns only,
+//in the same way as dvtable_recompute(). It is used when only these columns of the neighbors' distance vectors have changed.
+//If the column of this node is given (a neighbor's cost to this node changed), the backup next hops to all the nodes are recomputed.
+//Return the number of nodes whose cost or next hops changed.
+int dvtable_recomputecols(dv_t* dvtable, nbr_cost_entry_t* nct, routingtable_t* routingtable, const int* cols, int colNum);
+
+//A neighbor N is a loop-free alternate (LFA) next hop of this node S to a destination d if its shortest path to d
+//doesn't go back through S: D(N,d) < D(N,S) + D(S,d). D(N,d) is taken from N's distance vector, D(S,d) from this node's.
+//N's own route to S is poisoned in its distance vector when it goes straight over the link, so D(N,S) is the smaller
+//of its advertised cost and the link cost. The backup next hop of a destination is the LFA, other than the equal-cost
+//next hops, with the lowest cost through it. It is used when all the next hops are down, until the routes are recomputed.
+#define DVTABLE_LOOPFREE(nbrCostToDest, nbrCostToMe, myCostToDest) ((nbrCostToDest) < (nbrCostToMe) + (myCostToDest))
+
+//This function empties the list of changed columns, it is called after the changes have been advertised.
+void dvtable_clearchanged(dv_t* dvtable);
+
+//This function returns 1 if the given neighbor is one of the equal-cost next hops of this node to the node of column j.
+int dvtable_isnexthop(dv_t* dvtable, int nbrID, int j);
+
+//DVTABLE_ADVERTISED is the cost this node advertises to the given neighbor for the node of column j.
+//A route learned from the neighbor is advertised back to it with cost INFINITE_COST (split horizon with poisoned reverse),
+//so that the neighbor never routes back through this node. This holds for all the equal-cost next hops.
+#define DVTABLE_ADVERTISED(dvtable, nbrID, j) (dvtable_isnexthop(dvtable, nbrID, j) ? INFINITE_COST : DVTABLE_ROW(dvtable, 0)[j])
+
 //This function prints out the contents of a dvtable.
 void dvtable_print(dv_t* dvtable);
 
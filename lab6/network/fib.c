@@ -0,0 +1,168 @@
+//FILE: network/fib.c
+//
+//Description: this file implements the forwarding information base (FIB) of the SNP process
+//
+//Date: October 17, 2026
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "../topology/topology.h"
+#include "fib.h"
+
+//a published FIB, it never changes after it is published
+typedef struct fib {
+    int nodeNum;
+    int* backups;               //backup next hop per node, it points into the same allocation
+    int paths[];                //ECMP_MAX_PATHS next hops per node, followed by the backups
+} fib_t;
+
+//hazard pointer of a forwarding thread
+//the slots are never freed, the forwarding threads live as long as the process
+typedef struct fibreader {
+    fib_t* hazard;              //the FIB the thread is reading, or NULL
+    struct fibreader* next;
+} fib_reader_t;
+
+static fib_t* fib_current = NULL;
+//down flag of the link to each node by node index, allocated by the first fib_publish()
+static int* fib_linkDown = NULL;
+static fib_reader_t* fib_readers = NULL;
+//protects the list of readers
+static pthread_mutex_t fib_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread fib_reader_t* fib_myreader = NULL;
+
+//register the calling thread as a reader
+static fib_reader_t* fib_register()
+{
+    fib_reader_t* reader = (fib_reader_t*)calloc(1, sizeof(fib_reader_t));
+    pthread_mutex_lock(&fib_mutex);
+    reader->next = fib_readers;
+    __atomic_store_n(&fib_readers, reader, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&fib_mutex);
+    return reader;
+}
+
+void fib_publish(const int* paths, const int* backups, int nodeNum)
+{
+    fib_t* fib = (fib_t*)malloc(sizeof(fib_t) + sizeof(int) * ((size_t)nodeNum * (ECMP_MAX_PATHS + 1) + 1));
+    fib->nodeNum = nodeNum;
+    fib->backups = fib->paths + (size_t)nodeNum * ECMP_MAX_PATHS;
+    memcpy(fib->paths, paths, sizeof(int) * nodeNum * ECMP_MAX_PATHS);
+    for (int j = 0; j < nodeNum; j++) {
+        fib->backups[j] = backups != NULL ? backups[j] : -1;
+    }
+    if (fib_linkDown == NULL) {
+        __atomic_store_n(&fib_linkDown, (int*)calloc(nodeNum + 1, sizeof(int)), __ATOMIC_RELEASE);
+    }
+
+    fib_t* old = __atomic_exchange_n(&fib_current, fib, __ATOMIC_SEQ_CST);
+    if (old == NULL) {
+        return;
+    }
+
+    // wait until no reader holds the old FIB, readers only hold a FIB for one lookup
+    pthread_mutex_lock(&fib_mutex);
+    for (fib_reader_t* reader = fib_readers; reader != NULL; reader = reader->next) {
+        while (__atomic_load_n(&reader->hazard, __ATOMIC_SEQ_CST) == old) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&fib_mutex);
+    free(old);
+}
+
+void fib_setlinkdown(int nbrNodeID, int down)
+{
+    int* linkDown = __atomic_load_n(&fib_linkDown, __ATOMIC_ACQUIRE);
+    int idx = topology_getNodeIndex(nbrNodeID);
+    if (linkDown != NULL && idx >= 0) {
+        __atomic_store_n(&linkDown[idx], down, __ATOMIC_RELEASE);
+    }
+}
+
+//return 1 if the link to the given next hop is down
+static int fib_isdown(const int* linkDown, int nextNodeID)
+{
+    int idx = topology_getNodeIndex(nextNodeID);
+    return idx >= 0 && __atomic_load_n(&linkDown[idx], __ATOMIC_ACQUIRE);
+}
+
+//mix a 32 bit value into a flow hash
+static unsigned int fib_mix(unsigned int hash, unsigned int value)
+{
+    value *= 0xcc9e2d51u;
+    value = (value << 15) | (value >> 17);
+    hash ^= value * 0x1b873593u;
+    hash = (hash << 13) | (hash >> 19);
+    return hash * 5 + 0xe6546b64u;
+}
+
+unsigned int fib_flowhash(int srcNodeID, int destNodeID, unsigned int srcPort, unsigned int destPort)
+{
+    unsigned int hash = 0;
+    hash = fib_mix(hash, (unsigned int)srcNodeID);
+    hash = fib_mix(hash, (unsigned int)destNodeID);
+    hash = fib_mix(hash, srcPort);
+    hash = fib_mix(hash, destPort);
+    // spread all the bits, the next hop is picked by the low bits
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+int fib_getnextnode(int destNodeID, unsigned int flowHash)
+{
+    if (fib_myreader == NULL) {
+        fib_myreader = fib_register();
+    }
+
+    // announce the FIB before reading it, and make sure it is still the current one
+    fib_t* fib = __atomic_load_n(&fib_current, __ATOMIC_ACQUIRE);
+    fib_t* check;
+    do {
+        __atomic_store_n(&fib_myreader->hazard, fib, __ATOMIC_SEQ_CST);
+        check = fib;
+        fib = __atomic_load_n(&fib_current, __ATOMIC_SEQ_CST);
+    } while (fib != check);
+
+    int nextNodeID = -1;
+    int idx = topology_getNodeIndex(destNodeID);
+    if (fib != NULL && idx >= 0 && idx < fib->nodeNum) {
+        const int* paths = fib->paths + (size_t)idx * ECMP_MAX_PATHS;
+        int pathNum = 0;
+        while (pathNum < ECMP_MAX_PATHS && paths[pathNum] >= 0) {
+            pathNum++;
+        }
+        if (pathNum > 0) {
+            nextNodeID = paths[flowHash % pathNum];
+        }
+        const int* linkDown = __atomic_load_n(&fib_linkDown, __ATOMIC_ACQUIRE);
+        if (nextNodeID >= 0 && fib_isdown(linkDown, nextNodeID)) {
+            // the flow moves to one of the next hops that are still up, or to the backup
+            int up[ECMP_MAX_PATHS];
+            int upNum = 0;
+            for (int k = 0; k < pathNum; k++) {
+                if (!fib_isdown(linkDown, paths[k])) {
+                    up[upNum++] = paths[k];
+                }
+            }
+            if (upNum > 0) {
+                nextNodeID = up[flowHash % upNum];
+            }
+            else if (fib->backups[idx] >= 0 && !fib_isdown(linkDown, fib->backups[idx])) {
+                nextNodeID = fib->backups[idx];
+            }
+            else {
+                nextNodeID = -1;
+            }
+        }
+    }
+    __atomic_store_n(&fib_myreader->hazard, NULL, __ATOMIC_RELEASE);
+    return nextNodeID;
+}
@@ -0,0 +1,48 @@
+//FILE: network/fib.h
+//
+//Description: this file defines the forwarding information base (FIB) of the SNP process
+//
+//The FIB is the read-only copy of the routing table used to forward packets: a dense array of next hops
+//indexed by the destination's index in the topology (see topology_getNodeIndex()), ECMP_MAX_PATHS equal-cost
+//next hops per destination. A packet takes one of them by the hash of its flow (fib_flowhash()), so the
+//packets of a flow stay in order while different flows spread over the equal-cost paths. The route computation
+//builds a new FIB each time the routes change and publishes it with one atomic pointer swap, so a
+//forwarding lookup takes no lock and never waits for the route computation.
+//
+//Each destination may also have a backup next hop, precomputed by the route computation (see DVTABLE_LOOPFREE in dvtable.h).
+//When a link is reported down (fib_setlinkdown()), the lookups skip the next hops over that link right away, before the
+//routes are recomputed: a flow moves to one of the other equal-cost next hops, or to the backup next hop if they are all down.
+//
+//A FIB that has been replaced is freed once no forwarding thread is reading it. Each forwarding thread
+//announces the FIB it is reading in its own hazard pointer, the publisher waits until no hazard
+//pointer holds the old FIB before freeing it.
+//
+//Date: October 17, 2026
+
+#ifndef FIB_H
+#define FIB_H
+
+#include "../common/constants.h"
+
+//This function publishes a new FIB. paths[j * ECMP_MAX_PATHS + k] is the k-th equal-cost next hop to the j-th node
+//of the topology, the unused ones are -1. A node is unreachable if it has no next hop.
+//backups[j] is the backup next hop to the j-th node, -1 if there is none. backups may be NULL if there are no backups.
+//The arrays are copied, the old FIB is freed once no thread reads it.
+//Only one thread may publish at a time.
+void fib_publish(const int* paths, const int* backups, int nodeNum);
+
+//This function marks the link to the given neighbor down (down = 1) or up again (down = 0).
+//The lookups skip the next hops over a down link. It never blocks and can be called from any thread.
+void fib_setlinkdown(int nbrNodeID, int down);
+
+//This function returns the hash of a flow, it is used to pick one of the equal-cost next hops.
+unsigned int fib_flowhash(int srcNodeID, int destNodeID, unsigned int srcPort, unsigned int destPort);
+
+//This function looks up the next hop to the destination in the current FIB.
+//If the destination has several equal-cost next hops, the one picked by flowHash among the ones whose link is up is returned,
+//and if all their links are down, the backup next hop.
+//If the destination is unknown or unreachable, or all its next hops are down, return -1.
+//It never blocks and can be called from any thread.
+int fib_getnextnode(int destNodeID, unsigned int flowHash);
+
+#endif
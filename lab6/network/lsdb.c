@@ -0,0 +1,400 @@
+//FILE: network/lsdb.c
+//
+//Description: this file implements the link state database used by the SNP process in link state routing mode
+//
+//Date: October 17, 2026
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+
+#include "../common/constants.h"
+#include "../common/config.h"
+#include "../topology/topology.h"
+#include "lsdb.h"
+
+//marks a node index already seen in lsdb_replace()
+#define LSDB_SEEN UINT_MAX
+
+//return 1 if sequence number a is newer than b, the sequence numbers may wrap around
+static int lsdb_newer(unsigned int a, unsigned int b)
+{
+    return (int)(a - b) > 0;
+}
+
+//return the cost of the link from the node of index from to the node of index to, INFINITE_COST if it isn't listed
+static unsigned int lsdb_linkcost(lsdb_t* lsdb, int from, int to)
+{
+    lsdb_entry_t *e = &lsdb->lsa[from];
+    for (int k = 0; k < e->linkNum; k++){
+        if (e->linkIdx[k] == to){
+            return e->linkCost[k];
+        }
+    }
+    return INFINITE_COST;
+}
+
+//return 1 if a link of the given cost from the node of index from gives a path to the node of index to
+//as short as its shortest path, according to the last lsdb_compute()
+static int lsdb_reaches(lsdb_t* lsdb, int from, int to, unsigned int cost)
+{
+    unsigned int *dist = lsdb->dist;
+    return cost < INFINITE_COST && dist[from] < INFINITE_COST && dist[from] + cost < lsdb->infinity && dist[from] + cost <= dist[to];
+}
+
+//return 1 if changing the cost of the link from the node of index o to the node of index v from oldCost to newCost
+//may change the shortest paths, otherwise return 0
+//a link on a shortest path may change the paths whatever its new cost is, another link only if it gets cheaper
+//and gives a path as short as the current one
+static int lsdb_affects(lsdb_t* lsdb, int o, int v, unsigned int oldCost, unsigned int newCost)
+{
+    if (lsdb_reaches(lsdb, o, v, oldCost) || (newCost < oldCost && lsdb_reaches(lsdb, o, v, newCost))){
+        return 1;
+    }
+    // adding or removing the link also makes the link back from v usable or not
+    if (oldCost == INFINITE_COST || newCost == INFINITE_COST){
+        return lsdb_reaches(lsdb, v, o, lsdb_linkcost(lsdb, v, o));
+    }
+    return 0;
+}
+
+//replace the LSA of the node of index idx with lsa
+//return LSDB_CHANGED if the shortest paths may change, otherwise return LSDB_NEWER
+static int lsdb_replace(lsdb_t* lsdb, int idx, const pkt_lsa_t* lsa)
+{
+    lsdb_entry_t *e = &lsdb->lsa[idx];
+    unsigned int *old = lsdb->linkScratch;
+    int linkNum = lsa->linkNum < LSA_MAX_LINKS ? lsa->linkNum : LSA_MAX_LINKS;
+    int *linkIdx = (int *)malloc(sizeof(int) * (linkNum + 1));
+    unsigned int *linkCost = (unsigned int *)malloc(sizeof(unsigned int) * (linkNum + 1));
+    // the first LSA of a node may cut links to it that were used before, see lsdb_compute()
+    int affects = !e->valid;
+
+    for (int k = 0; k < e->linkNum; k++){
+        old[e->linkIdx[k]] = e->linkCost[k];
+    }
+    int n = 0;
+    for (int k = 0; k < linkNum; k++){
+        int v = topology_getNodeIndex(lsa->link[k].nodeID);
+        unsigned int cost = lsa->link[k].cost;
+        // links to unknown nodes, down links and repeated links are left out
+        if (v < 0 || v == idx || cost >= lsdb->infinity || old[v] == LSDB_SEEN){
+            continue;
+        }
+        if (old[v] != cost && !affects){
+            affects = lsdb_affects(lsdb, idx, v, old[v], cost);
+        }
+        old[v] = LSDB_SEEN;
+        linkIdx[n] = v;
+        linkCost[n] = cost;
+        n++;
+    }
+    // the links that are gone
+    for (int k = 0; k < e->linkNum; k++){
+        int v = e->linkIdx[k];
+        if (old[v] != LSDB_SEEN && !affects){
+            affects = lsdb_affects(lsdb, idx, v, old[v], INFINITE_COST);
+        }
+        old[v] = INFINITE_COST;
+    }
+    for (int k = 0; k < n; k++){
+        old[linkIdx[k]] = INFINITE_COST;
+    }
+
+    free(e->linkIdx);
+    free(e->linkCost);
+    e->valid = 1;
+    e->seqNum = lsa->seqNum;
+    e->linkNum = n;
+    e->linkIdx = linkIdx;
+    e->linkCost = linkCost;
+    if (affects){
+        lsdb->dirty = 1;
+        return LSDB_CHANGED;
+    }
+    return LSDB_NEWER;
+}
+
+//This function creates a link state database dynamically. No LSA is known yet, all the nodes are unreachable.
+//The sequence number of this node's LSAs starts from the current time, so that the LSAs sent after a restart
+//are newer than the ones sent before.
+lsdb_t* lsdb_create()
+{
+    int nodeNum = topology_getNodeNum();
+    lsdb_t *lsdb = (lsdb_t *)malloc(sizeof(lsdb_t));
+    lsdb->nodeNum = nodeNum;
+    lsdb->myIdx = topology_getNodeIndex(topology_getMyNodeID());
+    lsdb->nodeIDs = topology_getNodeArray();
+    lsdb->infinity = config_getInfinity();
+    lsdb->mySeqNum = (unsigned int)time(NULL);
+    lsdb->lsa = (lsdb_entry_t *)calloc(nodeNum + 1, sizeof(lsdb_entry_t));
+    lsdb->dirty = 0;
+    lsdb->dist = (unsigned int *)malloc(sizeof(unsigned int) * (nodeNum + 1));
+    lsdb->paths = (int *)malloc(sizeof(int) * ((size_t)nodeNum * ECMP_MAX_PATHS + 1));
+    lsdb->firstHops = (int *)malloc(sizeof(int) * ((size_t)nodeNum * ECMP_MAX_PATHS + 1));
+    lsdb->heap = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    lsdb->heapPos = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    lsdb->linkScratch = (unsigned int *)malloc(sizeof(unsigned int) * (nodeNum + 1));
+
+    for (int j = 0; j < nodeNum; j++){
+        lsdb->dist[j] = j == lsdb->myIdx ? 0 : INFINITE_COST;
+        lsdb->linkScratch[j] = INFINITE_COST;
+    }
+    for (size_t k = 0; k < (size_t)nodeNum * ECMP_MAX_PATHS; k++){
+        lsdb->paths[k] = -1;
+    }
+    return lsdb;
+}
+
+//This function destroys a link state database.
+//It frees all the dynamically allocated memory for the database.
+void lsdb_destroy(lsdb_t* lsdb)
+{
+    for (int j = 0; j < lsdb->nodeNum; j++){
+        free(lsdb->lsa[j].linkIdx);
+        free(lsdb->lsa[j].linkCost);
+    }
+    free(lsdb->nodeIDs);
+    free(lsdb->lsa);
+    free(lsdb->dist);
+    free(lsdb->paths);
+    free(lsdb->firstHops);
+    free(lsdb->heap);
+    free(lsdb->heapPos);
+    free(lsdb->linkScratch);
+    free(lsdb);
+}
+
+//This function installs an LSA received from the overlay.
+//If the LSA is not newer than the one in the database it is dropped.
+//A newer LSA replaces the one in the database. If the changed links may change the shortest paths
+//(a new or cheaper link that gives a path as short as the current one, or any change of a link on a shortest path),
+//the database is marked dirty, otherwise the current routes are kept without running Dijkstra's algorithm.
+//Return LSDB_OLD, LSDB_NEWER, LSDB_CHANGED or LSDB_SELF.
+int lsdb_install(lsdb_t* lsdb, const pkt_lsa_t* lsa)
+{
+    int idx = topology_getNodeIndex(lsa->originID);
+    if (idx < 0){
+        return LSDB_OLD;
+    }
+    // this node's own links are only set by lsdb_originate()
+    if (idx == lsdb->myIdx){
+        if (lsdb_newer(lsa->seqNum, lsdb->mySeqNum)){
+            lsdb->mySeqNum = lsa->seqNum;
+            return LSDB_SELF;
+        }
+        return LSDB_OLD;
+    }
+    if (lsdb->lsa[idx].valid && !lsdb_newer(lsa->seqNum, lsdb->lsa[idx].seqNum)){
+        return LSDB_OLD;
+    }
+    return lsdb_replace(lsdb, idx, lsa);
+}
+
+//This function builds a new LSA of this node in lsa from the direct link costs in nct, with the next sequence number,
+//and installs it. Links whose cost reaches the infinity of the database are left out.
+//Return LSDB_NEWER or LSDB_CHANGED, as lsdb_install().
+int lsdb_originate(lsdb_t* lsdb, nbr_cost_entry_t* nct, pkt_lsa_t* lsa)
+{
+    int nbrNum = topology_getNbrNum();
+    lsa->originID = lsdb->nodeIDs[lsdb->myIdx];
+    lsa->seqNum = ++lsdb->mySeqNum;
+    lsa->flags = 0;
+    lsa->linkNum = 0;
+    for (int i = 0; i < nbrNum && lsa->linkNum < LSA_MAX_LINKS; i++){
+        if (nct[i].cost < lsdb->infinity){
+            lsa->link[lsa->linkNum].nodeID = nct[i].nodeID;
+            lsa->link[lsa->linkNum].cost = nct[i].cost;
+            lsa->linkNum++;
+        }
+    }
+    return lsdb_replace(lsdb, lsdb->myIdx, lsa);
+}
+
+//This function copies the LSA of the node with the given index into lsa.
+//Return the length of the LSA, or 0 if no LSA of this node is known.
+int lsdb_getlsa(lsdb_t* lsdb, int idx, pkt_lsa_t* lsa)
+{
+    lsdb_entry_t *e = &lsdb->lsa[idx];
+    if (!e->valid){
+        return 0;
+    }
+    lsa->originID = lsdb->nodeIDs[idx];
+    lsa->seqNum = e->seqNum;
+    lsa->flags = 0;
+    lsa->linkNum = e->linkNum;
+    for (int k = 0; k < e->linkNum; k++){
+        lsa->link[k].nodeID = lsdb->nodeIDs[e->linkIdx[k]];
+        lsa->link[k].cost = e->linkCost[k];
+    }
+    return LSA_LEN(e->linkNum);
+}
+
+//return 1 if node index a comes before node index b in the heap: by cost, then by index
+static int lsdb_heapless(lsdb_t* lsdb, int a, int b)
+{
+    return lsdb->dist[a] < lsdb->dist[b] || (lsdb->dist[a] == lsdb->dist[b] && a < b);
+}
+
+//move the node index at position pos of the heap up to its place
+static void lsdb_siftup(lsdb_t* lsdb, int pos)
+{
+    int *heap = lsdb->heap;
+    int idx = heap[pos];
+    while (pos > 0 && lsdb_heapless(lsdb, idx, heap[(pos - 1) / 2])){
+        heap[pos] = heap[(pos - 1) / 2];
+        lsdb->heapPos[heap[pos]] = pos;
+        pos = (pos - 1) / 2;
+    }
+    heap[pos] = idx;
+    lsdb->heapPos[idx] = pos;
+}
+
+//move the node index at position pos of the heap down to its place
+static void lsdb_siftdown(lsdb_t* lsdb, int pos, int heapNum)
+{
+    int *heap = lsdb->heap;
+    int idx = heap[pos];
+    while (2 * pos + 1 < heapNum){
+        int child = 2 * pos + 1;
+        if (child + 1 < heapNum && lsdb_heapless(lsdb, heap[child + 1], heap[child])){
+            child++;
+        }
+        if (!lsdb_heapless(lsdb, heap[child], idx)){
+            break;
+        }
+        heap[pos] = heap[child];
+        lsdb->heapPos[heap[pos]] = pos;
+        pos = child;
+    }
+    heap[pos] = idx;
+    lsdb->heapPos[idx] = pos;
+}
+
+//add the first hop index hop to the equal-cost first hops of a node, if it isn't there and there is room
+static void lsdb_addhop(int* hops, int hop)
+{
+    for (int k = 0; k < ECMP_MAX_PATHS; k++){
+        if (hops[k] == hop){
+            return;
+        }
+        if (hops[k] < 0){
+            hops[k] = hop;
+            return;
+        }
+    }
+}
+
+//This function recomputes the shortest paths of this node with Dijkstra's algorithm, if the database is dirty.
+//The first hops of all the shortest paths to a node are kept as its equal-cost next hops, up to ECMP_MAX_PATHS,
+//in the order they are found. The nodes are taken from the heap by cost and then by index, so all the nodes
+//with the same database compute the same paths. The routing table entries of the nodes whose next hops changed are updated,
+//unreachable nodes are removed from the routing table.
+//Return the number of nodes whose next hops changed.
+int lsdb_compute(lsdb_t* lsdb, routingtable_t* routingtable)
+{
+    if (!lsdb->dirty || lsdb->myIdx < 0){
+        return 0;
+    }
+    lsdb->dirty = 0;
+    int nodeNum = lsdb->nodeNum;
+    unsigned int *dist = lsdb->dist;
+    int *hops = lsdb->firstHops;
+    for (int j = 0; j < nodeNum; j++){
+        dist[j] = INFINITE_COST;
+        lsdb->heapPos[j] = -1;
+    }
+    for (size_t k = 0; k < (size_t)nodeNum * ECMP_MAX_PATHS; k++){
+        hops[k] = -1;
+    }
+
+    dist[lsdb->myIdx] = 0;
+    lsdb->heap[0] = lsdb->myIdx;
+    lsdb->heapPos[lsdb->myIdx] = 0;
+    int heapNum = 1;
+    while (heapNum > 0){
+        int u = lsdb->heap[0];
+        lsdb->heapPos[u] = -1;
+        heapNum--;
+        if (heapNum > 0){
+            lsdb->heap[0] = lsdb->heap[heapNum];
+            lsdb_siftdown(lsdb, 0, heapNum);
+        }
+
+        lsdb_entry_t *e = &lsdb->lsa[u];
+        for (int k = 0; k < e->linkNum; k++){
+            int v = e->linkIdx[k];
+            unsigned int cost = dist[u] + e->linkCost[k];
+            if (v == lsdb->myIdx || cost >= lsdb->infinity || cost > dist[v]){
+                continue;
+            }
+            // a link is used only if the other end lists it too, once its LSA is known
+            if (lsdb->lsa[v].valid && lsdb_linkcost(lsdb, v, u) >= lsdb->infinity){
+                continue;
+            }
+            int *vHops = hops + (size_t)v * ECMP_MAX_PATHS;
+            if (cost < dist[v]){
+                // a shorter path, the first hops found so far are dropped
+                dist[v] = cost;
+                for (int h = 0; h < ECMP_MAX_PATHS; h++){
+                    vHops[h] = -1;
+                }
+                if (lsdb->heapPos[v] < 0){
+                    lsdb->heap[heapNum] = v;
+                    lsdb_siftup(lsdb, heapNum);
+                    heapNum++;
+                }
+                else {
+                    lsdb_siftup(lsdb, lsdb->heapPos[v]);
+                }
+            }
+            // v is reached through the first hops of u, or directly
+            if (u == lsdb->myIdx){
+                lsdb_addhop(vHops, v);
+            }
+            for (int h = 0; u != lsdb->myIdx && h < ECMP_MAX_PATHS && hops[(size_t)u * ECMP_MAX_PATHS + h] >= 0; h++){
+                lsdb_addhop(vHops, hops[(size_t)u * ECMP_MAX_PATHS + h]);
+            }
+        }
+    }
+
+    int changed = 0;
+    int newPaths[ECMP_MAX_PATHS];
+    for (int j = 0; j < nodeNum; j++){
+        int *paths = lsdb->paths + (size_t)j * ECMP_MAX_PATHS;
+        int pathNum = 0;
+        for (int h = 0; h < ECMP_MAX_PATHS; h++){
+            int hop = hops[(size_t)j * ECMP_MAX_PATHS + h];
+            newPaths[h] = hop < 0 ? -1 : lsdb->nodeIDs[hop];
+            pathNum += hop >= 0;
+        }
+        if (j == lsdb->myIdx || memcmp(paths, newPaths, sizeof(newPaths)) == 0){
+            continue;
+        }
+        memcpy(paths, newPaths, sizeof(newPaths));
+        if (pathNum == 0){
+            routingtable_removenode(routingtable, lsdb->nodeIDs[j]);
+        }
+        else {
+            routingtable_setnextnodes(routingtable, lsdb->nodeIDs[j], newPaths, pathNum);
+        }
+        changed++;
+    }
+    return changed;
+}
+
+//This function prints out the contents of a link state database.
+void lsdb_print(lsdb_t* lsdb)
+{
+    printf("This is link state database of %d:\n", lsdb->nodeIDs[lsdb->myIdx]);
+    printf("fromNode  toNode  cost\n");
+    for (int j = 0; j < lsdb->nodeNum; j++){
+        lsdb_entry_t *e = &lsdb->lsa[j];
+        for (int k = 0; k < e->linkNum; k++){
+            printf("%d \t %d \t %u\n", lsdb->nodeIDs[j], lsdb->nodeIDs[e->linkIdx[k]], e->linkCost[k]);
+        }
+    }
+}
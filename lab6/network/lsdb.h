@@ -0,0 +1,93 @@
+//FILE: network/lsdb.h
+//
+//Description: this file defines the link state database used by the SNP process in link state routing mode
+//
+//In link state mode (see the routing mode in common/config.h) each node floods a link state advertisement (LSA,
+//see pkt_lsa_t in common/pkt.h) listing its direct links to all the nodes of the overlay, instead of sending its
+//distance vector to its neighbors. Every node keeps the newest LSA of each node in its link state database,
+//and computes its routes from the whole database with Dijkstra's algorithm. All the nodes compute their routes
+//from the same links, so the routes converge as soon as the LSAs have been flooded and the forwarding is loop-free.
+//
+//An LSA replaces the one in the database only if its sequence number is larger, and only a newer LSA is flooded
+//on, so a flood ends by itself. A link is used only if both of its ends list it (once both LSAs are known).
+//
+//Date: October 17, 2026
+
+#ifndef LSDB_H
+#define LSDB_H
+
+#include "../common/pkt.h"
+#include "nbrcosttable.h"
+#include "routingtable.h"
+
+//results of lsdb_install()
+#define LSDB_OLD 0		//the LSA is not newer than the one in the database, it is dropped
+#define LSDB_NEWER 1		//the LSA is installed, the routes are not affected
+#define LSDB_CHANGED 2		//the LSA is installed, the routes must be recomputed with lsdb_compute()
+#define LSDB_SELF 3		//the LSA is a newer copy of this node's own LSA left from before a restart, this node must send a new LSA
+
+//the newest LSA of a node, the links are kept by node index (see topology_getNodeIndex())
+typedef struct lsdb_entry {
+	int valid;			//set once an LSA of the node has been installed
+	unsigned int seqNum;		//sequence number of the LSA
+	int linkNum;			//number of links
+	int* linkIdx;			//index of the node at the other end of each link
+	unsigned int* linkCost;		//cost of each link
+} lsdb_entry_t;
+
+//A link state database contains the newest LSA of each of the N nodes in the overlay, by node index,
+//and the shortest paths of this node computed from them.
+typedef struct lsdb {
+	int nodeNum;			//number of nodes, N
+	int myIdx;			//index of this node
+	int* nodeIDs;			//node ID of each index
+	unsigned int infinity;		//a route whose cost reaches infinity is unreachable, see ROUTE_INFINITY in constants.h
+	unsigned int mySeqNum;		//sequence number of the last LSA of this node
+	lsdb_entry_t* lsa;		//the LSA of each node
+	int dirty;			//set when an installed LSA may change the shortest paths
+	unsigned int* dist;		//cost of the shortest path to each node, INFINITE_COST if it is unreachable
+	int* paths;			//equal-cost next hops to each node, ECMP_MAX_PATHS per node, the unused ones are -1
+	int* firstHops;			//scratch equal-cost next hop indices used by lsdb_compute(), ECMP_MAX_PATHS per node
+	int* heap;			//scratch binary heap of node indices ordered by dist, used by lsdb_compute()
+	int* heapPos;			//position of each node index in the heap, -1 if it is not in the heap
+	unsigned int* linkScratch;	//scratch link cost by node index used by lsdb_install(), INFINITE_COST when unused
+} lsdb_t;
+
+//This function creates a link state database dynamically. No LSA is known yet, all the nodes are unreachable.
+//The sequence number of this node's LSAs starts from the current time, so that the LSAs sent after a restart
+//are newer than the ones sent before.
+lsdb_t* lsdb_create();
+
+//This function destroys a link state database.
+//It frees all the dynamically allocated memory for the database.
+void lsdb_destroy(lsdb_t* lsdb);
+
+//This function installs an LSA received from the overlay.
+//If the LSA is not newer than the one in the database it is dropped.
+//A newer LSA replaces the one in the database. If the changed links may change the shortest paths
+//(a new or cheaper link that gives a path as short as the current one, or any change of a link on a shortest path),
+//the database is marked dirty, otherwise the current routes are kept without running Dijkstra's algorithm.
+//Return LSDB_OLD, LSDB_NEWER, LSDB_CHANGED or LSDB_SELF.
+int lsdb_install(lsdb_t* lsdb, const pkt_lsa_t* lsa);
+
+//This function builds a new LSA of this node in lsa from the direct link costs in nct, with the next sequence number,
+//and installs it. Links whose cost reaches the infinity of the database are left out.
+//Return LSDB_NEWER or LSDB_CHANGED, as lsdb_install().
+int lsdb_originate(lsdb_t* lsdb, nbr_cost_entry_t* nct, pkt_lsa_t* lsa);
+
+//This function copies the LSA of the node with the given index into lsa.
+//Return the length of the LSA, or 0 if no LSA of this node is known.
+int lsdb_getlsa(lsdb_t* lsdb, int idx, pkt_lsa_t* lsa);
+
+//This function recomputes the shortest paths of this node with Dijkstra's algorithm, if the database is dirty.
+//The first hops of all the shortest paths to a node are kept as its equal-cost next hops, up to ECMP_MAX_PATHS,
+//in the order they are found. The nodes are taken from the heap by cost and then by index, so all the nodes
+//with the same database compute the same paths. The routing table entries of the nodes whose next hops changed are updated,
+//unreachable nodes are removed from the routing table.
+//Return the number of nodes whose next hops changed.
+int lsdb_compute(lsdb_t* lsdb, routingtable_t* routingtable);
+
+//This function prints out the contents of a link state database.
+void lsdb_print(lsdb_t* lsdb);
+
+#endif
@@ -56,6 +56,23 @@ unsigned int nbrcosttable_getcost(nbr_cost_entry_t* nct, int nodeID)
     return INFINITE_COST;
 }
 
+//This function sets the direct link cost to a neighbor, it is used when the ON process reports a new measured cost.
+//Return 1 if the cost has changed, 0 if it is the same, and -1 if the node is not found in the table.
+int nbrcosttable_setcost(nbr_cost_entry_t* nct, int nodeID, unsigned int cost)
+{
+    int nbrNum = topology_getNbrNum();
+    for (int i = 0; i < nbrNum; i++){
+        if (nct[i].nodeID == nodeID){
+            if (nct[i].cost == cost){
+                return 0;
+            }
+            nct[i].cost = cost;
+            return 1;
+        }
+    }
+    return -1;
+}
+
 //This function prints out the contents of a neighbor cost table.
 void nbrcosttable_print(nbr_cost_entry_t* nct)
 {
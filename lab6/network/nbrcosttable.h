@@ -28,6 +28,10 @@ void nbrcosttable_destroy(nbr_cost_entry_t* nct);
 //INFINITE_COST is returned if the node is not found in the table.
 unsigned int nbrcosttable_getcost(nbr_cost_entry_t* nct, int nodeID);
 
+//This function sets the direct link cost to a neighbor, it is used when the ON process reports a new measured cost.
+//Return 1 if the cost has changed, 0 if it is the same, and -1 if the node is not found in the table.
+int nbrcosttable_setcost(nbr_cost_entry_t* nct, int nodeID, unsigned int cost);
+
 //This function prints out the contents of a neighbor cost table.
 void nbrcosttable_print(nbr_cost_entry_t* nct); 
 
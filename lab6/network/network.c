@@ -4,6 +4,7 @@
 //
 //Date: April 29,2008
 
+#define _POSIX_C_SOURCE 200809L
 
 
 #include <stdio.h>
@@ -24,11 +25,16 @@
 #include "../common/constants.h"
 #include "../common/pkt.h"
 #include "../common/seg.h"
+#include "../common/ipc.h"
+#include "../common/log.h"
+#include "../common/config.h"
 #include "../topology/topology.h"
 #include "network.h"
 #include "nbrcosttable.h"
 #include "dvtable.h"
 #include "routingtable.h"
+#include "fib.h"
+#include "lsdb.h"
 
 //network layer waits this time for establishing the routing paths 
 #define NETWORK_WAITTIME 60
@@ -40,89 +46,253 @@
 int overlay_conn; 			//connection to the overlay
 int transport_conn;			//connection to the transport
 nbr_cost_entry_t* nct;			//neighbor cost table
-dv_t* dv;				//distance vector table
+dv_t* dv;				//distance vector table, distance vector mode only
 pthread_mutex_t* dv_mutex;		//dvtable mutex
+lsdb_t* lsdb;				//link state database, link state mode only
+pthread_mutex_t* lsdb_mutex;		//lsdb mutex
 routingtable_t* routingtable;		//routing table
 pthread_mutex_t* routingtable_mutex;	//routingtable mutex
+int update_triggered;			//set when this node's distance vector (or its links in link state mode) has changed and a triggered route update should be sent
+int update_full;			//set when the next route update should carry the whole distance vector
+pthread_mutex_t update_mutex;		//protects update_triggered and update_full
+pthread_cond_t update_cond;		//signaled when update_triggered is set
 
 
 /**************************************************************/
 //implementation network layer functions
 /**************************************************************/
 
-//This function is used to for the SNP process to connect to the local ON process on port OVERLAY_PORT.
-//TCP descriptor is returned if success, otherwise return -1.
-int connectToOverlay() {
-    //put your code here
-    int sockfd;
-    if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-        perror("socket creation error\n");
-        return -1;
+//return the time in milliseconds on the monotonic clock
+static long long now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+//sleep for the given number of milliseconds
+static void sleep_ms(long long ms) {
+    if (ms <= 0){
+        return;
     }
-    
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(OVERLAY_PORT);
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    
-    if ((connect(sockfd, (struct sockaddr *)&(server_addr), sizeof(struct sockaddr))) == -1) {
-        perror("connect error\n");
-        return -1;
+    struct timespec interval;
+    interval.tv_sec = ms / 1000;
+    interval.tv_nsec = (ms % 1000) * 1000000L;
+    nanosleep(&interval, NULL);
+}
+
+//ask the route update thread to send a triggered route update
+//if full is set, the update carries the whole distance vector, otherwise only the changed entries
+static void routeupdate_trigger(int full) {
+    pthread_mutex_lock(&update_mutex);
+    update_triggered = 1;
+    update_full |= full;
+    pthread_cond_signal(&update_cond);
+    pthread_mutex_unlock(&update_mutex);
+}
+
+//recompute the routes from the link state database if it is dirty, and publish the new FIB if a next hop has changed
+//it is called with lsdb_mutex held
+//return the number of nodes whose next hop changed
+static int linkstate_recompute() {
+    pthread_mutex_lock(routingtable_mutex);
+    int changed = lsdb_compute(lsdb, routingtable);
+    pthread_mutex_unlock(routingtable_mutex);
+    if (changed){
+        fib_publish(lsdb->paths, NULL, lsdb->nodeNum);
     }
-    
-    return sockfd;
+    return changed;
 }
 
-//This thread sends out route update packets every ROUTEUPDATE_INTERVAL time
-//The route update packet contains this node's distance vector. 
-//Broadcasting is done by set the dest_nodeID in packet header as BROADCAST_NODEID
-//and use overlay_sendpkt() to send the packet out using BROADCAST_NODEID address.
+//publish the FIB of the distance vector table with its backup next hops
+//it is called with dv_mutex held
+static void distvector_publish() {
+    fib_publish(dv->paths, dv->backups, dv->nodeNum);
+    dv->backupsChanged = 0;
+}
+
+//This function is used to for the SNP process to connect to the local ON process on port OVERLAY_PORT (or the one set in the instance configuration).
+//TCP descriptor is returned if success, otherwise return -1.
+int connectToOverlay() {
+    return ipc_connect(config_getOverlayPort());
+}
+
+//This thread sends out route update packets when this node's distance vector changes (triggered update),
+//and every ROUTEUPDATE_INTERVAL time otherwise (periodic update).
+//A triggered update is sent ROUTEUPDATE_HOLDDOWN milliseconds after the change, so that a burst of changes goes out
+//in one update, and at least ROUTEUPDATE_MIN_GAP milliseconds after the previous update.
+//The periodic interval doubles after each periodic update up to ROUTEUPDATE_MAX_INTERVAL while the routes are stable,
+//and goes back to ROUTEUPDATE_INTERVAL after a triggered update.
+//A triggered update only carries the entries of this node's distance vector that changed since the last update (delta update),
+//a periodic update carries the whole distance vector, so that a neighbor that missed an update catches up.
+//The route update packets contain this node's distance vector, ROUTEUPDATE_MAX_ENTRIES entries per packet. 
+//Each neighbor gets its own copy of the distance vector, in which the routes learned from that neighbor are
+//poisoned (split horizon with poisoned reverse, see DVTABLE_ADVERTISED in dvtable.h).
+//The packets for all the neighbors are sent with one overlay_sendpkt_batch() call.
+//In link state mode this thread floods a new LSA of this node's links (see lsdb.h) at the same times instead,
+//the first one asks the neighbors for their link state databases (LSA_FLAG_SYNC).
 void* routeupdate_daemon(void* arg) {
-    pkt_routeupdate_t *pkt_routeupdate = (pkt_routeupdate_t * )malloc(sizeof(pkt_routeupdate_t));
-    snp_pkt_t *pkt = (snp_pkt_t * )malloc(sizeof(snp_pkt_t));
+    int nodeNum = topology_getNodeNum();
+    int nbrNum = topology_getNbrNum();
+    int *nbr_array = topology_getNbrArray();
+    int maxPktNum = (nodeNum + ROUTEUPDATE_MAX_ENTRIES - 1) / ROUTEUPDATE_MAX_ENTRIES * nbrNum;
+    snp_pkt_t *pkts = (snp_pkt_t *)malloc(sizeof(snp_pkt_t) * (maxPktNum + 1));
+    snp_pkt_t **pktPtrs = (snp_pkt_t **)malloc(sizeof(snp_pkt_t *) * (maxPktNum + 1));
+    int *nextNodeIDs = (int *)malloc(sizeof(int) * (maxPktNum + 1));
+    // columns of the distance vector carried by the update
+    int *cols = (int *)malloc(sizeof(int) * (nodeNum + 1));
+    for (int i = 0; i < maxPktNum; i++){
+        memset(&pkts[i].header, 0, sizeof(snp_hdr_t));
+        pkts[i].header.src_nodeID = topology_getMyNodeID();
+        pkts[i].header.type = ROUTE_UPDATE;
+        pktPtrs[i] = &pkts[i];
+    }
+    snp_pkt_t lsaPkt;
+    memset(&lsaPkt.header, 0, sizeof(snp_hdr_t));
+    lsaPkt.header.src_nodeID = topology_getMyNodeID();
+    lsaPkt.header.dest_nodeID = BROADCAST_NODEID;
+    lsaPkt.header.type = LINK_STATE;
+    int lsaNum = 0;
+    
+    long long interval = ROUTEUPDATE_INTERVAL * 1000LL;
+    long long lastSent = 0;
+    long long nextPeriodic = now_ms() + interval;
     while (1){
-        sleep(ROUTEUPDATE_INTERVAL);
+        // wait for a triggered update or the next periodic update
+        pthread_mutex_lock(&update_mutex);
+        while (!update_triggered && now_ms() < nextPeriodic){
+            struct timespec deadline;
+            deadline.tv_sec = nextPeriodic / 1000;
+            deadline.tv_nsec = (nextPeriodic % 1000) * 1000000L;
+            pthread_cond_timedwait(&update_cond, &update_mutex, &deadline);
+        }
+        int triggered = update_triggered;
+        pthread_mutex_unlock(&update_mutex);
         
-        memset(pkt_routeupdate, 0, sizeof(pkt_routeupdate_t));
-        // route update packet contains this node's distance vector
-        pkt_routeupdate->entryNum = topology_getNodeNum();
-        pthread_mutex_lock(dv_mutex);
-        for (int i = 0; i < pkt_routeupdate->entryNum; i++){
-            pkt_routeupdate->entry[i].nodeID = dv[0].dvEntry[i].nodeID;
-            pkt_routeupdate->entry[i].cost = dv[0].dvEntry[i].cost;
+        if (triggered){
+            long long sendTime = now_ms() + ROUTEUPDATE_HOLDDOWN;
+            if (sendTime < lastSent + ROUTEUPDATE_MIN_GAP){
+                sendTime = lastSent + ROUTEUPDATE_MIN_GAP;
+            }
+            sleep_ms(sendTime - now_ms());
+            interval = ROUTEUPDATE_INTERVAL * 1000LL;
         }
-        pthread_mutex_unlock(dv_mutex);
+        else if (interval < ROUTEUPDATE_MAX_INTERVAL * 1000LL){
+            // routes are stable, refresh less often
+            interval *= 2;
+            if (interval > ROUTEUPDATE_MAX_INTERVAL * 1000LL){
+                interval = ROUTEUPDATE_MAX_INTERVAL * 1000LL;
+            }
+        }
+        // the kind of update is taken after the hold-down, together with clearing the trigger, so that a full update
+        // asked for during the hold-down is not lost; changes made from now on trigger another update
+        pthread_mutex_lock(&update_mutex);
+        int full = update_full || !triggered;
+        update_triggered = 0;
+        update_full = 0;
+        pthread_mutex_unlock(&update_mutex);
         
-        memset(pkt, 0, sizeof(snp_pkt_t));
-        pkt->header.src_nodeID = topology_getMyNodeID();
-        pkt->header.dest_nodeID = BROADCAST_NODEID;
-        pkt->header.type = ROUTE_UPDATE;
-        pkt->header.length = sizeof(snp_hdr_t) + sizeof(pkt_routeupdate_t);
-        memcpy(pkt->data, pkt_routeupdate, sizeof(pkt_routeupdate_t));
+        if (config_getRouting() == CONFIG_ROUTING_LS){
+            // the LSA is built in place in the packet data and flooded through the overlay broadcast
+            pkt_lsa_t *lsa = (pkt_lsa_t *)lsaPkt.data;
+            pthread_mutex_lock(lsdb_mutex);
+            if (lsdb_originate(lsdb, nct, lsa) == LSDB_CHANGED){
+                linkstate_recompute();
+            }
+            pthread_mutex_unlock(lsdb_mutex);
+            if (lsaNum++ == 0){
+                lsa->flags = LSA_FLAG_SYNC;
+            }
+            lsaPkt.header.length = LSA_LEN(lsa->linkNum);
+            if (overlay_sendpkt(BROADCAST_NODEID, &lsaPkt, overlay_conn) < 0){
+                LOG_ERROR("lose connection with overlay!\n");
+                break;
+            }
+            LOG_DEBUG("Routing: flood LSA %u with %u links to overlay!\n", lsa->seqNum, lsa->linkNum);
+        }
+        else {
+            // route update packets contain this node's distance vector, or its changed entries, built in place in the packet data
+            pthread_mutex_lock(dv_mutex);
+            int colNum = full ? nodeNum : dv->changedNum;
+            for (int j = 0; j < colNum; j++){
+                cols[j] = full ? j : dv->changedCols[j];
+            }
+            dvtable_clearchanged(dv);
+            int vecPktNum = (colNum + ROUTEUPDATE_MAX_ENTRIES - 1) / ROUTEUPDATE_MAX_ENTRIES;
+            int pktNum = vecPktNum * nbrNum;
+            for (int i = 0; i < pktNum; i++){
+                pkt_routeupdate_t *pkt_routeupdate = (pkt_routeupdate_t *)pkts[i].data;
+                int nbrID = nbr_array[i / vecPktNum];
+                int first = (i % vecPktNum) * ROUTEUPDATE_MAX_ENTRIES;
+                pkt_routeupdate->entryNum = colNum - first < ROUTEUPDATE_MAX_ENTRIES ? colNum - first : ROUTEUPDATE_MAX_ENTRIES;
+                for (int j = 0; j < pkt_routeupdate->entryNum; j++){
+                    pkt_routeupdate->entry[j].nodeID = dv->nodeIDs[cols[first + j]];
+                    pkt_routeupdate->entry[j].cost = DVTABLE_ADVERTISED(dv, nbrID, cols[first + j]);
+                }
+                // only the used entries are sent
+                pkts[i].header.dest_nodeID = nbrID;
+                pkts[i].header.length = ROUTEUPDATE_LEN(pkt_routeupdate->entryNum);
+                nextNodeIDs[i] = nbrID;
+            }
+            pthread_mutex_unlock(dv_mutex);
         
-        if (overlay_sendpkt(BROADCAST_NODEID, pkt, overlay_conn) < 0){
-            printf("lose connection with overlay!\n");
-            free(pkt_routeupdate);
-            free(pkt);
-            network_stop();
-            break;
+            if (overlay_sendpkt_batch(nextNodeIDs, pktPtrs, pktNum, overlay_conn) < 0){
+                LOG_ERROR("lose connection with overlay!\n");
+                break;
+            }
+            LOG_DEBUG("Routing: send %d %s route update pkts with %d entries to overlay!\n", pktNum, full ? "full" : "delta", colNum);
         }
-        printf("Routing: send a pkt to overlay!\n");
+        lastSent = now_ms();
+        nextPeriodic = lastSent + interval;
     }
     
-    free(pkt_routeupdate);
-    free(pkt);
+    free(pkts);
+    free(pktPtrs);
+    free(nextNodeIDs);
+    free(cols);
+    free(nbr_array);
+    network_stop();
     
     pthread_detach(pthread_self());
     pthread_exit(0);
 }
 
+//put all the LSAs in the link state database into the packets syncPkts, at most syncMax of them, to be sent to the neighbor nbrID
+//it is called with lsdb_mutex held
+//Return the number of packets.
+static int linkstate_syncpkts(int nbrID, snp_pkt_t *syncPkts, snp_pkt_t **syncPtrs, int *syncNext, int syncMax)
+{
+    int syncNum = 0;
+    for (int j = 0; j < syncMax; j++){
+        int len = lsdb_getlsa(lsdb, j, (pkt_lsa_t *)syncPkts[syncNum].data);
+        if (len > 0){
+            syncPkts[syncNum].header.src_nodeID = topology_getMyNodeID();
+            syncPkts[syncNum].header.dest_nodeID = nbrID;
+            syncPkts[syncNum].header.type = LINK_STATE;
+            syncPkts[syncNum].header.length = len;
+            syncPtrs[syncNum] = &syncPkts[syncNum];
+            syncNext[syncNum] = nbrID;
+            syncNum++;
+        }
+    }
+    return syncNum;
+}
+
 //This thread handles incoming packets from the ON process.
 //It receives packets from the ON process by calling overlay_recvpkt().
 //If the packet is a SNP packet and the destination node is this node, forward the packet to the SRT process.
-//If the packet is a SNP packet and the destination node is not this node, forward the packet to the next hop according to the routing table.
-//If this packet is an Route Update packet, update the distance vector table and the routing table. 
+//If the packet is a SNP packet and the destination node is not this node, forward the packet to the next hop according to the routing table (looked up in the FIB, see fib.h).
+//If this packet is an Route Update packet, update the distance vector table, recompute this node's distance vector and the routing table,
+//and trigger a route update if this node's distance vector has changed. 
+//If this packet is an LSA (link state mode), install it in the link state database, flood it on if it is newer than the one
+//in the database, and recompute the routes if it changes them. An LSA with LSA_FLAG_SYNC received from its origin
+//is answered with all the LSAs in the database.
+//If this packet is a LINK_COST packet from the local ON process, set the new measured link costs in the neighbor cost table,
+//and recompute the routes (distance vector mode) or send a new LSA (link state mode). A link reported down (cost INFINITE_COST)
+//withdraws the routes through that neighbor at once: the forwarding moves to the other next hops or to the backup next hops
+//right away (see fib.h), the routes are recomputed, and the neighbor's distance vector is forgotten. When a link comes back up
+//the whole distance vector is sent, so that the neighbor learns the routes again without waiting for a periodic update.
+//If this packet is a LINK_RESYNC packet from the local ON process, the listed neighbors missed some routing packets: the whole
+//distance vector is sent (distance vector mode), or all the LSAs in the database are sent to them (link state mode).
 void* pkthandler(void* arg) {
     /*
     snp_pkt_t *pkt = (snp_pkt_t *)malloc(sizeof(snp_pkt_t));
@@ -130,67 +300,214 @@ void* pkthandler(void* arg) {
     seg_t *segPtr = (seg_t *)malloc(sizeof(seg_t));
     */
     snp_pkt_t pkt;
-    pkt_routeupdate_t pkt_routeupdate;
-    seg_t segPtr;
+    // columns of the distance vector table changed by a route update packet
+    int *cols = (int *)malloc(sizeof(int) * ROUTEUPDATE_MAX_ENTRIES);
+    // the LSAs sent back to a neighbor that asks for the link state database
+    int syncMax = config_getRouting() == CONFIG_ROUTING_LS ? topology_getNodeNum() : 0;
+    snp_pkt_t *syncPkts = (snp_pkt_t *)malloc(sizeof(snp_pkt_t) * (syncMax + 1));
+    snp_pkt_t **syncPtrs = (snp_pkt_t **)malloc(sizeof(snp_pkt_t *) * (syncMax + 1));
+    int *syncNext = (int *)malloc(sizeof(int) * (syncMax + 1));
     
     while(overlay_recvpkt(&pkt, overlay_conn) > 0){
         if (pkt.header.type == ROUTE_UPDATE){
-            printf("Routing: received a pkt from neighbor %d!\n",pkt.header.src_nodeID);
-            //pkt_routeupdate_t *pkt_routeupdate = (pkt_routeupdate_t *)malloc(sizeof(pkt_routeupdate_t));
-            memmove(&pkt_routeupdate, pkt.data, pkt.header.length);
+            LOG_DEBUG("Routing: received a pkt from neighbor %d!\n",pkt.header.src_nodeID);
+            if (dv == NULL){
+                LOG_WARN("Routing: route update from %d dropped in link state mode!\n", pkt.header.src_nodeID);
+                continue;
+            }
+            // the route update is read in place in the packet data
+            // a distance vector may come in several packets, each packet carries its own entries
+            pkt_routeupdate_t *pkt_routeupdate = (pkt_routeupdate_t *)pkt.data;
+            if (pkt.header.length < ROUTEUPDATE_LEN(0)) {
+                LOG_WARN("Routing: bad route update length %d!\n", pkt.header.length);
+                continue;
+            }
+            if (pkt_routeupdate->entryNum > (pkt.header.length - ROUTEUPDATE_LEN(0)) / sizeof(routeupdate_entry_t)) {
+                pkt_routeupdate->entryNum = (pkt.header.length - ROUTEUPDATE_LEN(0)) / sizeof(routeupdate_entry_t);
+            }
             
-            // step 1: update the distance vector table
+            // step 1: update the neighbor's distance vector in the distance vector table
             pthread_mutex_lock(dv_mutex);
-            for (int i = 0; i < pkt_routeupdate.entryNum; i++){
-                //printf("jump into dvtable_setcost()\n");
-                dvtable_setcost(dv, pkt.header.src_nodeID, pkt_routeupdate.entry[i].nodeID, pkt_routeupdate.entry[i].cost);
+            int row = dvtable_getrow(dv, pkt.header.src_nodeID);
+            int colNum = 0;
+            for (int i = 0; row > 0 && i < pkt_routeupdate->entryNum; i++){
+                int idx = topology_getNodeIndex(pkt_routeupdate->entry[i].nodeID);
+                unsigned int cost = pkt_routeupdate->entry[i].cost < dv->infinity ? pkt_routeupdate->entry[i].cost : INFINITE_COST;
+                if (idx >= 0 && DVTABLE_ROW(dv, row)[idx] != cost){
+                    DVTABLE_ROW(dv, row)[idx] = cost;
+                    cols[colNum++] = idx;
+                }
+            }
+            
+            // step 2: recompute this node's routes to the nodes whose entries changed, and the routing table
+            // costs may go up as well as down, and unreachable nodes are withdrawn
+            int changed = 0;
+            if (colNum > 0){
+                pthread_mutex_lock(routingtable_mutex);
+                changed = dvtable_recomputecols(dv, nct, routingtable, cols, colNum);
+                pthread_mutex_unlock(routingtable_mutex);
+            }
+            // the forwarding threads switch to the new next hops without taking a lock
+            if (changed || dv->backupsChanged){
+                distvector_publish();
             }
             pthread_mutex_unlock(dv_mutex);
             
-            // step 2: update the distance vector table and the routing table
-            pthread_mutex_lock(dv_mutex);
-            pthread_mutex_lock(routingtable_mutex);
-            for (int i = 0; i < pkt_routeupdate.entryNum; i++){
-                unsigned int new_cost = nbrcosttable_getcost(nct, pkt.header.src_nodeID) +
-                pkt_routeupdate.entry[i].cost;
-                if (dv[0].dvEntry[i].cost > new_cost){ // find a shortcut, update dv table and routing table
-                    dv[0].dvEntry[i].cost = new_cost;
-                    routingtable_setnextnode(routingtable, dv[0].dvEntry[i].nodeID, pkt.header.src_nodeID);
+            // step 3: tell the neighbors right away if this node's distance vector has changed
+            if (changed){
+                LOG_DEBUG("Routing: %d routes changed!\n", changed);
+                routeupdate_trigger(0);
+            }
+        }
+        else if (pkt.header.type == LINK_STATE){
+            pkt_lsa_t *lsa = (pkt_lsa_t *)pkt.data;
+            if (pkt.header.length < LSA_LEN(0) || lsa->linkNum > (pkt.header.length - LSA_LEN(0)) / sizeof(routeupdate_entry_t)) {
+                LOG_WARN("Routing: bad LSA length %d!\n", pkt.header.length);
+                continue;
+            }
+            if (lsdb == NULL){
+                LOG_WARN("Routing: LSA from %d dropped in distance vector mode!\n", pkt.header.src_nodeID);
+                continue;
+            }
+            int sync = pkt.header.src_nodeID == (int)lsa->originID && (lsa->flags & LSA_FLAG_SYNC);
+            
+            pthread_mutex_lock(lsdb_mutex);
+            int ret = lsdb_install(lsdb, lsa);
+            int changed = ret == LSDB_CHANGED ? linkstate_recompute() : 0;
+            int syncNum = sync ? linkstate_syncpkts(pkt.header.src_nodeID, syncPkts, syncPtrs, syncNext, syncMax) : 0;
+            pthread_mutex_unlock(lsdb_mutex);
+            LOG_DEBUG("Routing: LSA %u of %d from %d, %d routes changed!\n", lsa->seqNum, lsa->originID, pkt.header.src_nodeID, changed);
+            
+            if (syncNum > 0){
+                overlay_sendpkt_batch(syncNext, syncPtrs, syncNum, overlay_conn);
+            }
+            if (ret == LSDB_SELF){
+                // the overlay still has an LSA of this node from before a restart, replace it
+                routeupdate_trigger(1);
+            }
+            else if (ret != LSDB_OLD){
+                // flood a newer LSA on to all the neighbors, the copy sent back is dropped as not newer
+                pkt.header.src_nodeID = topology_getMyNodeID();
+                pkt.header.dest_nodeID = BROADCAST_NODEID;
+                overlay_sendpkt(BROADCAST_NODEID, &pkt, overlay_conn);
+            }
+        }
+        else if (pkt.header.type == LINK_RESYNC){
+            // the neighbors that missed route updates or LSAs are in the route update format, the costs are not used
+            pkt_routeupdate_t *nbrs = (pkt_routeupdate_t *)pkt.data;
+            if (pkt.header.length < ROUTEUPDATE_LEN(0) || nbrs->entryNum > (pkt.header.length - ROUTEUPDATE_LEN(0)) / sizeof(routeupdate_entry_t)) {
+                LOG_WARN("Routing: bad link resync length %d!\n", pkt.header.length);
+                continue;
+            }
+            for (int i = 0; i < nbrs->entryNum; i++){
+                LOG_WARN("Routing: routing packets to %d were dropped, sending the whole routing state again!\n", nbrs->entry[i].nodeID);
+                if (lsdb != NULL){
+                    pthread_mutex_lock(lsdb_mutex);
+                    int syncNum = linkstate_syncpkts(nbrs->entry[i].nodeID, syncPkts, syncPtrs, syncNext, syncMax);
+                    pthread_mutex_unlock(lsdb_mutex);
+                    if (syncNum > 0){
+                        overlay_sendpkt_batch(syncNext, syncPtrs, syncNum, overlay_conn);
+                    }
                 }
             }
-            pthread_mutex_unlock(routingtable_mutex);
-            pthread_mutex_unlock(dv_mutex);
+            if (dv != NULL && nbrs->entryNum > 0){
+                routeupdate_trigger(1);
+            }
+        }
+        else if (pkt.header.type == LINK_COST){
+            // the new costs are in the route update format, each entry is a neighbor and the link cost to it
+            pkt_routeupdate_t *costs = (pkt_routeupdate_t *)pkt.data;
+            if (pkt.header.length < ROUTEUPDATE_LEN(0) || costs->entryNum > (pkt.header.length - ROUTEUPDATE_LEN(0)) / sizeof(routeupdate_entry_t)) {
+                LOG_WARN("Routing: bad link cost length %d!\n", pkt.header.length);
+                continue;
+            }
             
-            //printf("going to free pkt_routeupdate\n");
-            //free(pkt_routeupdate);
+            // the neighbor cost table is read by the route computation under the mutex of the routing mode
+            pthread_mutex_t *mutex = dv != NULL ? dv_mutex : lsdb_mutex;
+            int linkChanged = 0;
+            int linkUp = 0;
+            int changed = 0;
+            pthread_mutex_lock(mutex);
+            for (int i = 0; i < costs->entryNum; i++){
+                int nbrID = costs->entry[i].nodeID;
+                unsigned int oldCost = nbrcosttable_getcost(nct, nbrID);
+                if (nbrcosttable_setcost(nct, nbrID, costs->entry[i].cost) <= 0){
+                    continue;
+                }
+                linkChanged++;
+                if (costs->entry[i].cost >= config_getInfinity()){
+                    LOG_WARN("Routing: link to %d is down!\n", nbrID);
+                    // forwarding moves off the link at once, the routes are recomputed below
+                    fib_setlinkdown(nbrID, 1);
+                    if (dv != NULL){
+                        dvtable_clearrow(dv, nbrID);
+                    }
+                }
+                else if (oldCost >= config_getInfinity()){
+                    LOG_INFO("Routing: link to %d is up, cost %u!\n", nbrID, costs->entry[i].cost);
+                    fib_setlinkdown(nbrID, 0);
+                    linkUp++;
+                }
+                else {
+                    LOG_INFO("Routing: link cost to %d is %u!\n", nbrID, costs->entry[i].cost);
+                }
+            }
+            // a link cost changes the routes through that neighbor to all the nodes
+            if (linkChanged > 0 && dv != NULL){
+                pthread_mutex_lock(routingtable_mutex);
+                changed = dvtable_recompute(dv, nct, routingtable);
+                pthread_mutex_unlock(routingtable_mutex);
+                if (changed || dv->backupsChanged){
+                    distvector_publish();
+                }
+            }
+            pthread_mutex_unlock(mutex);
+            
+            if (changed || (linkUp > 0 && dv != NULL)){
+                routeupdate_trigger(linkUp > 0);
+            }
+            else if (linkChanged > 0 && lsdb != NULL){
+                // the new LSA is built and the routes are recomputed by the route update thread
+                routeupdate_trigger(1);
+            }
         }
         else if (pkt.header.type == SNP){
             // pkt successfully arrived destination
-            printf("SNP: received a packet from neighbor %d!\n",pkt.header.src_nodeID);
+            LOG_DEBUG("SNP: received a packet from neighbor %d!\n",pkt.header.src_nodeID);
             if (topology_getMyNodeID() == pkt.header.dest_nodeID){
-                printf("SNP: pkt from %d to %d successfully arrived destination!\n", pkt.header.src_nodeID, pkt.header.dest_nodeID);
-                //seg_t *segPtr = (seg_t *)malloc(sizeof(seg_t));
-                memmove(&segPtr, pkt.data, pkt.header.length);
-                forwardsegToSRT(transport_conn, pkt.header.src_nodeID, &segPtr);
-                printf("SNP: forward pkt to SRT!\n");
+                LOG_DEBUG("SNP: pkt from %d to %d successfully arrived destination!\n", pkt.header.src_nodeID, pkt.header.dest_nodeID);
+                // decapsulation: the segment is forwarded straight from the packet data
+                seg_t* seg = (seg_t*)pkt.data;
+                if (pkt.header.length < sizeof(srt_hdr_t) || sizeof(srt_hdr_t) + seg->header.length > pkt.header.length) {
+                    LOG_WARN("SNP: bad segment length in pkt!\n");
+                    continue;
+                }
+                forwardsegToSRT(transport_conn, pkt.header.src_nodeID, seg);
+                LOG_DEBUG("SNP: forward pkt to SRT!\n");
                 continue;
             }
             else{
-                pthread_mutex_lock(routingtable_mutex);
-                int nextNodeID = routingtable_getnextnode(routingtable, pkt.header.dest_nodeID);
-                pthread_mutex_unlock(routingtable_mutex);
+                // the packets of a flow take the same one of the equal-cost next hops
+                seg_t* seg = (seg_t*)pkt.data;
+                unsigned int flowHash = pkt.header.length < sizeof(srt_hdr_t) ? fib_flowhash(pkt.header.src_nodeID, pkt.header.dest_nodeID, 0, 0)
+                    : fib_flowhash(pkt.header.src_nodeID, pkt.header.dest_nodeID, seg->header.src_port, seg->header.dest_port);
+                int nextNodeID = fib_getnextnode(pkt.header.dest_nodeID, flowHash);
                 
                 overlay_sendpkt(nextNodeID, &pkt, overlay_conn);
-                printf("SNP: sent a pkt to nextNode %d through overlay, destination is node %d\n", nextNodeID, pkt.header.dest_nodeID);
+                LOG_DEBUG("SNP: sent a pkt to nextNode %d through overlay, destination is node %d\n", nextNodeID, pkt.header.dest_nodeID);
                 continue;
             }
         }
         else {
-            printf("Type not specified in pkt!\n");
+            LOG_WARN("Type not specified in pkt!\n");
         }
     }
     
-    printf("lose connection with overlay!\n");
+    LOG_ERROR("lose connection with overlay!\n");
+    free(cols);
+    free(syncPkts);
+    free(syncPtrs);
+    free(syncNext);
     network_stop();
     
     pthread_detach(pthread_self());
@@ -199,136 +516,163 @@ void* pkthandler(void* arg) {
 
 //This function stops the SNP process. 
 //It closes all the connections and frees all the dynamically allocated memory.
-//It is called when the SNP process receives a signal SIGINT.
+//It is called when the SNP process receives a signal SIGINT, by the thread that waits for it.
 void network_stop() {
 	//put your code here
+    frame_release(overlay_conn);
     close(overlay_conn);
     overlay_conn = -1;
+    frame_release(transport_conn);
     close(transport_conn);
     transport_conn = -1;
     
     free(dv_mutex);
     free(routingtable_mutex);
+    free(lsdb_mutex);
     nbrcosttable_destroy(nct);
-    dvtable_destroy(dv);
+    if (dv != NULL){
+        dvtable_destroy(dv);
+    }
+    if (lsdb != NULL){
+        lsdb_destroy(lsdb);
+    }
     routingtable_destroy(routingtable);
     
-    printf("snp is shutting down...\n");
+    LOG_INFO("snp is shutting down...\n");
     exit(0);
 }
 
-//This function opens a port on NETWORK_PORT and waits for the TCP connection from local SRT process.
-//After the local SRT process is connected, this function keeps receiving sendseg_arg_ts which contains the segments and their destination node addresses from the SRT process. The received segments are then encapsulated into packets (one segment in one packet), and sent to the next hop using overlay_sendpkt. The next hop is retrieved from routing table.
+//This function opens a port on NETWORK_PORT (or the one set in the instance configuration) and waits for the TCP connection from local SRT process.
+//After the local SRT process is connected, this function keeps receiving sendseg_arg_ts which contains the segments and their destination node addresses from the SRT process. The received segments are then encapsulated into packets (one segment in one packet), and sent to the next hop using overlay_sendpkt. The next hop is retrieved from the FIB, see fib.h.
 //When a local SRT process is disconnected, this function waits for the next SRT process to connect.
 void waitTransport() {
-    int sockfd;
-    // create a new socket
-    if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-        perror("socket creation error\n");
-        exit(1);
-    }
-    
-    struct sockaddr_in server_addr, client_addr;
-    /* Prepare the socket address structure of the server */
-    server_addr.sin_family = AF_INET;       // host byte order
-    server_addr.sin_port = htons(NETWORK_PORT);   // short, network byte order
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY); // automatically fill with my IP address "localhost"
-    memset(&(server_addr.sin_zero), '\0', 8); // zero the rest of the struct
-    
-    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr)) == -1) {
-        perror("bind error\n");
-        exit(1);
-    }
-    
-    if (listen(sockfd, 1) == -1) {
-        perror("listen error\n");
+    int sockfd = ipc_listen(config_getNetworkPort());
+    if (sockfd < 0) {
         exit(1);
     }
     
-    socklen_t sin_size;
-    sin_size = sizeof(struct sockaddr_in);
-    
     // wait connection with local SRT process
     while (1){
-        if ((transport_conn = accept(sockfd, (struct sockaddr *)&(client_addr), &sin_size)) == -1) {
-            perror("accept error\n");
+        if ((transport_conn = ipc_accept(sockfd)) == -1) {
             exit(1);
         }
         
-        printf("connected to local SRT!\n");
+        LOG_INFO("connected to local SRT!\n");
         
-        seg_t *seg = (seg_t *)malloc(sizeof(seg_t));
-        int *destNode = (int *)malloc(sizeof(int));
+        // the segment is received straight into the data of the packet, the packet header is
+        // filled in front of it, so encapsulation doesn't copy the segment
+        snp_pkt_t pkt;
+        seg_t* seg = (seg_t*)pkt.data;
+        int destNode;
         
         while (1){
             // getting sendseg_arg_ts from SRT process
-            if (getsegToSend(transport_conn, destNode, seg) < 0){
-                printf("lose connection with local SRT!\n");
+            if (getsegToSend(transport_conn, &destNode, seg) < 0){
+                LOG_ERROR("lose connection with local SRT!\n");
                 break;
             }
             
-            printf("SNP: get a segment from SRT process! Destination is node %d!\n", *destNode);
+            LOG_DEBUG("SNP: get a segment from SRT process! Destination is node %d!\n", destNode);
             
-            // retrieve next hop from routing table
-            int nextNodeID;
-            pthread_mutex_lock(routingtable_mutex);
-            nextNodeID = routingtable_getnextnode(routingtable, *destNode);
-            pthread_mutex_unlock(routingtable_mutex);
-            printf("Next node is %d\n", nextNodeID);
+            // retrieve next hop from the forwarding information base, a copy of the routing table read without a lock
+            // the segments of a connection (its SRT ports) take the same one of the equal-cost next hops
+            int nextNodeID = fib_getnextnode(destNode, fib_flowhash(topology_getMyNodeID(), destNode, seg->header.src_port, seg->header.dest_port));
+            LOG_DEBUG("Next node is %d\n", nextNodeID);
             
             // encapsulate segment into packet
-            snp_pkt_t *pkt = (snp_pkt_t *) malloc(sizeof(snp_pkt_t));
-            memset(pkt, 0, sizeof(snp_pkt_t));
-            pkt->header.dest_nodeID = *destNode;
-            pkt->header.src_nodeID = topology_getMyNodeID();
-            pkt->header.type = SNP;
-            pkt->header.length = sizeof(srt_hdr_t) + seg->header.length;
-            memmove(pkt->data, seg, pkt->header.length);
+            pkt.header.dest_nodeID = destNode;
+            pkt.header.src_nodeID = topology_getMyNodeID();
+            pkt.header.type = SNP;
+            pkt.header.length = sizeof(srt_hdr_t) + seg->header.length;
             
             // send packets to the next hop in the overlay network
-            overlay_sendpkt(nextNodeID, pkt, overlay_conn);
-            printf("SNP: sent a pkt to nextNode %d through overlay_conn %d\n", nextNodeID, overlay_conn);
-            
-            free(pkt);
+            overlay_sendpkt(nextNodeID, &pkt, overlay_conn);
+            LOG_DEBUG("SNP: sent a pkt to nextNode %d through overlay_conn %d\n", nextNodeID, overlay_conn);
         }
         
+        frame_release(transport_conn);
         close(transport_conn);
-        free(seg);
-        free(destNode);
     }
 }
 
+//SIGINT, which is blocked in all the threads and taken by network_waitstop()
+static sigset_t stop_sigs;
+
+//This thread waits for SIGINT and stops the SNP process. network_stop() runs in this thread and not in a signal handler,
+//so it can log and exit even if the signal comes while another thread holds a lock of the logging facility.
+static void* network_waitstop(void* arg) {
+    int sig;
+    while (sigwait(&stop_sigs, &sig) != 0 || sig != SIGINT);
+    network_stop();
+    return NULL;
+}
+
 int main(int argc, char *argv[]) {
-	printf("network layer is starting, pls wait...\n");
+	//block SIGINT before any thread is started, so that all the threads inherit the mask
+	sigemptyset(&stop_sigs);
+	sigaddset(&stop_sigs, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &stop_sigs, NULL);
+
+	log_init();
+	config_init(argc, argv);
+	LOG_INFO("network layer is starting, pls wait...\n");
 
 	//initialize global variables
     //printf("mark 1\n");
 	nct = nbrcosttable_create();
     //printf("mark 2\n");
-	dv = dvtable_create();
 	dv_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
 	pthread_mutex_init(dv_mutex,NULL);
+	lsdb_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+	pthread_mutex_init(lsdb_mutex,NULL);
     //printf("mark 3\n");
 	routingtable = routingtable_create();
 	routingtable_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
 	pthread_mutex_init(routingtable_mutex,NULL);
+	if (config_getRouting() == CONFIG_ROUTING_LS){
+		//this node's own links give the routes to the neighbors until the other LSAs arrive
+		snp_pkt_t lsaPkt;
+		lsdb = lsdb_create();
+		lsdb_originate(lsdb, nct, (pkt_lsa_t*)lsaPkt.data);
+		lsdb_compute(lsdb, routingtable);
+		fib_publish(lsdb->paths, NULL, lsdb->nodeNum);
+	}
+	else {
+		dv = dvtable_create();
+		fib_publish(dv->paths, dv->backups, dv->nodeNum);
+	}
 	overlay_conn = -1;
 	transport_conn = -1;
+	//send this node's distance vector as soon as the route update thread starts
+	update_triggered = 1;
+	update_full = 1;
+	pthread_mutex_init(&update_mutex,NULL);
+	pthread_condattr_t update_condattr;
+	pthread_condattr_init(&update_condattr);
+	pthread_condattr_setclock(&update_condattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&update_cond,&update_condattr);
+	pthread_condattr_destroy(&update_condattr);
     
     //printf("mark 4\n");
 	nbrcosttable_print(nct);
-	dvtable_print(dv);
+	if (dv != NULL){
+		dvtable_print(dv);
+	}
+	else {
+		lsdb_print(lsdb);
+	}
     //printf("mark 5\n");
 	routingtable_print(routingtable);
 
-	//register a signal handler which is used to terminate the process
-	signal(SIGINT, network_stop);
+	//start the thread which is used to terminate the process on SIGINT
+	pthread_t stop_thread;
+	pthread_create(&stop_thread,NULL,network_waitstop,(void*)0);
 
 	//connect to local ON process
     //printf("mark 6\n");
 	overlay_conn = connectToOverlay();
 	if(overlay_conn<0) {
-		printf("can't connect to overlay process\n");
+		LOG_ERROR("can't connect to overlay process\n");
 		exit(1);		
 	}
 	//printf("mark 7\n");
@@ -340,13 +684,13 @@ int main(int argc, char *argv[]) {
 	pthread_t routeupdate_thread;
 	pthread_create(&routeupdate_thread,NULL,routeupdate_daemon,(void*)0);	
 
-	printf("network layer is started...\n");
-	printf("waiting for routes to be established\n");
+	LOG_INFO("network layer is started...\n");
+	LOG_INFO("waiting for routes to be established\n");
 	sleep(NETWORK_WAITTIME);
 	routingtable_print(routingtable);
 
 	//wait connection from SRT process
-	printf("waiting for connection from SRT process\n");
+	LOG_INFO("waiting for connection from SRT process\n");
 	waitTransport(); 
 
 }
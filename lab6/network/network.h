@@ -12,26 +12,32 @@
 //TCP descriptor is returned if success, otherwise return -1.
 int connectToOverlay();
 
-//This thread sends out route update packets every ROUTEUPDATE_INTERVAL time
-//The route update packet contains this node's distance vector. 
+//This thread sends out route update packets when this node's distance vector changes (triggered update),
+//and every ROUTEUPDATE_INTERVAL time otherwise (periodic update), see network.c.
+//The route update packets contain this node's distance vector, ROUTEUPDATE_MAX_ENTRIES entries per packet. 
 //Broadcasting is done by set the dest_nodeID in packet header as BROADCAST_NODEID
-//and use overlay_sendpkt() to send the packet out using BROADCAST_NODEID address.
+//and use overlay_sendpkt_batch() to send all the packets out using BROADCAST_NODEID address.
+//In link state mode (see lsdb.h) this thread floods an LSA of this node's links at the same times instead.
 void* routeupdate_daemon(void* arg);
 
 //This thread handles incoming packets from the ON process.
 //It receives packets from the ON process by calling overlay_recvpkt().
 //If the packet is a SNP packet and the destination node is this node, forward the packet to the SRT process.
-//If the packet is a SNP packet and the destination node is not this node, forward the packet to the next hop according to the routing table.
-//If this packet is an Route Update packet, update the distance vector table and the routing table. 
+//If the packet is a SNP packet and the destination node is not this node, forward the packet to the next hop according to the routing table (looked up in the FIB, see fib.h).
+//If this packet is an Route Update packet, update the distance vector table, recompute this node's distance vector and the routing table,
+//and trigger a route update if this node's distance vector has changed. 
+//If this packet is an LSA (link state mode), install it in the link state database, flood it on if it is newer,
+//and recompute the routes if it changes them, see network.c.
+//If this packet is a LINK_COST packet from the local ON process, update the neighbor cost table and recompute the routes.
 void* pkthandler(void* arg); 
 
 //This function stops the SNP process. 
 //Tt closes all the connections and frees all the dynamically allocated memory.
-//Tt is called when the SNP process receives a signal SIGINT.
+//Tt is called when the SNP process receives a signal SIGINT, by the thread that waits for it.
 void network_stop();
 
 //This function opens a port on NETWORK_PORT and waits for the TCP connection from local SRT process.
-//After the local SRT process is connected, this function keeps receiving sendseg_arg_ts which contains the segments and their destination node addresses from the SRT process. The received segments are then encapsulated into packets (one segment in one packet), and sent to the next hop using overlay_sendpkt. The next hop is retrieved from routing table.
+//After the local SRT process is connected, this function keeps receiving sendseg_arg_ts which contains the segments and their destination node addresses from the SRT process. The received segments are then encapsulated into packets (one segment in one packet), and sent to the next hop using overlay_sendpkt. The next hop is retrieved from the FIB, see fib.h.
 //When a local SRT process is disconnected, this function waits for the next SRT process to connect.
 void waitTranport();
 #endif
@@ -10,17 +10,11 @@
 #include "routingtable.h"
 
 //This is the hash function used the by the routing table
-//It takes the hash key - destination node ID as input, 
+//It takes the hash key - destination node ID and the number of slots as input, 
 //and returns the hash value - slot number for this destination node ID.
-//
-//You can copy makehash() implementation below directly to routingtable.c:
-//int makehash(int node) {
-//	return node%MAX_ROUTINGTABLE_ENTRIES;
-//}
-//
-int makehash(int node)
+int makehash(int node, int slotNum)
 {
-    return node % MAX_ROUTINGTABLE_SLOTS;
+    return (unsigned int)node % slotNum;
 }
 
 //This function creates a routing table dynamically.
@@ -31,9 +25,11 @@ routingtable_t* routingtable_create()
 {
     // dynamically create a routing table
     routingtable_t *rt_table = (routingtable_t*)malloc(sizeof(routingtable_t));
-    for (int i = 0; i < MAX_ROUTINGTABLE_SLOTS; i++){
-        rt_table->hash[i] = NULL;
+    rt_table->slotNum = topology_getNodeNum() * ROUTINGTABLE_SLOTS_PER_NODE;
+    if (rt_table->slotNum == 0){
+        rt_table->slotNum = 1;
     }
+    rt_table->hash = (routingtable_entry_t**)calloc(rt_table->slotNum, sizeof(routingtable_entry_t*));
     
     int nbrNum = topology_getNbrNum();
     int *nbr_array = topology_getNbrArray();
@@ -49,7 +45,7 @@ routingtable_t* routingtable_create()
 //All dynamically allocated data structures for this routing table are freed.
 void routingtable_destroy(routingtable_t* routingtable)
 {
-    for (int i = 0; i < MAX_ROUTINGTABLE_SLOTS; i++){
+    for (int i = 0; i < routingtable->slotNum; i++){
         routingtable_entry_t *head = routingtable->hash[i];
         while (head != NULL){
             routingtable_entry_t *temp = head;
@@ -57,6 +53,7 @@ void routingtable_destroy(routingtable_t* routingtable)
             free(temp);
         }
     }
+    free(routingtable->hash);
     free(routingtable);
 }
 
@@ -69,7 +66,18 @@ void routingtable_destroy(routingtable_t* routingtable)
 //Then append the routing entry to the linked list in that slot.
 void routingtable_setnextnode(routingtable_t* routingtable, int destNodeID, int nextNodeID)
 {
-    int pos = makehash(destNodeID);
+    routingtable_setnextnodes(routingtable, destNodeID, &nextNodeID, 1);
+}
+
+//This function sets the pathNum equal-cost next hops of the given destination in the routing table, in the same way
+//as routingtable_setnextnode(). nextNodeIDs[0] becomes the next hop returned by routingtable_getnextnode().
+//At most ECMP_MAX_PATHS next hops are kept.
+void routingtable_setnextnodes(routingtable_t* routingtable, int destNodeID, const int* nextNodeIDs, int pathNum)
+{
+    if (pathNum > ECMP_MAX_PATHS){
+        pathNum = ECMP_MAX_PATHS;
+    }
+    int pos = makehash(destNodeID, routingtable->slotNum);
     
     routingtable_entry_t *head = routingtable->hash[pos];
     routingtable_entry_t *prev = NULL;
@@ -77,22 +85,58 @@ void routingtable_setnextnode(routingtable_t* routingtable, int destNodeID, int
         prev = head;
         // update the existing routing entry
         if (head->destNodeID == destNodeID){
-            head->nextNodeID = nextNodeID;
-            return;
+            break;
         }
         head = head->next;
     }
-    // add a routing entry with the given destNodeID and nextNodeID
-    head = (routingtable_entry_t *)malloc(sizeof(routingtable_entry_t));
-    head->destNodeID = destNodeID;
-    head->nextNodeID = nextNodeID;
-    head->next = NULL;
-    
-    if (prev == NULL){
-        routingtable->hash[pos] = head;
+    // add a routing entry with the given destNodeID
+    if (head == NULL){
+        head = (routingtable_entry_t *)malloc(sizeof(routingtable_entry_t));
+        head->destNodeID = destNodeID;
+        head->backupNodeID = -1;
+        head->next = NULL;
+        
+        if (prev == NULL){
+            routingtable->hash[pos] = head;
+        }
+        else {  // append to linked ist
+            prev->next = head;
+        }
+    }
+    head->nextNodeID = nextNodeIDs[0];
+    head->pathNum = pathNum;
+    memcpy(head->nextNodeIDs, nextNodeIDs, sizeof(int) * pathNum);
+}
+
+//This function sets the backup next hop of the given destination in the routing table, -1 for none.
+//If the destination has no routing entry, return -1, otherwise return 1.
+int routingtable_setbackupnode(routingtable_t* routingtable, int destNodeID, int backupNodeID)
+{
+    routingtable_entry_t *head = routingtable->hash[makehash(destNodeID, routingtable->slotNum)];
+    while (head != NULL){
+        if (head->destNodeID == destNodeID){
+            head->backupNodeID = backupNodeID;
+            return 1;
+        }
+        head = head->next;
     }
-    else {  // append to linked ist
-        prev->next = head;
+    return -1;
+}
+
+//This function removes the routing entry of the given destination from the routing table, if there is one.
+void routingtable_removenode(routingtable_t* routingtable, int destNodeID)
+{
+    int pos = makehash(destNodeID, routingtable->slotNum);
+    
+    routingtable_entry_t **link = &routingtable->hash[pos];
+    while (*link != NULL){
+        if ((*link)->destNodeID == destNodeID){
+            routingtable_entry_t *temp = *link;
+            *link = temp->next;
+            free(temp);
+            return;
+        }
+        link = &(*link)->next;
     }
 }
 
@@ -103,7 +147,7 @@ void routingtable_setnextnode(routingtable_t* routingtable, int destNodeID, int
 //If the destNodeID is not found, return -1.
 int routingtable_getnextnode(routingtable_t* routingtable, int destNodeID)
 {
-    int pos = makehash(destNodeID);
+    int pos = makehash(destNodeID, routingtable->slotNum);
     
     routingtable_entry_t *head = routingtable->hash[pos];
     while (head != NULL){
@@ -122,10 +166,17 @@ void routingtable_print(routingtable_t* routingtable)
     printf("This is routing table of %d:\n", myNodeID);
     printf("destNode  nextNode\n");
 
-    for (int i = 0; i < MAX_ROUTINGTABLE_SLOTS; i++){
+    for (int i = 0; i < routingtable->slotNum; i++){
         routingtable_entry_t *head = routingtable->hash[i];
         while (head != NULL){
-            printf("%d \t %d\n", head->destNodeID, head->nextNodeID);
+            printf("%d \t %d", head->destNodeID, head->nextNodeID);
+            for (int k = 1; k < head->pathNum; k++){
+                printf(",%d", head->nextNodeIDs[k]);
+            }
+            if (head->backupNodeID >= 0){
+                printf(" \t backup %d", head->backupNodeID);
+            }
+            printf("\n");
             head = head->next;
         }
     }
@@ -1,7 +1,7 @@
 //FILE: network/routingtable.h
 //
 //Description: this file defines the data structures and functions for routing table. 
-//A routing table is a hash table containing MAX_RT_ENTRY slot entries.  
+//A routing table is a hash table whose number of slots is set from the number of nodes in the overlay.  
 //
 //Date: April 29,2008
 
@@ -10,28 +10,31 @@
 #ifndef ROUTINGTABLE_H
 #define ROUTINGTABLE_H
 
+#include "../common/constants.h"
+
 //routingtable_entry_t is the routing entry contained in the routing table.
+//A destination has up to ECMP_MAX_PATHS next hops of equal cost, the first one is also kept in nextNodeID,
+//and may have a backup next hop that is used when they are all down, see DVTABLE_LOOPFREE in dvtable.h.
 typedef struct routingtable_entry {
 	int destNodeID;		//destination node ID
 	int nextNodeID;		//next node ID to which the packet should be forwarded
+	int pathNum;		//number of equal-cost next hops
+	int nextNodeIDs[ECMP_MAX_PATHS];	//the equal-cost next hops, nextNodeIDs[0] is nextNodeID
+	int backupNodeID;	//loop-free backup next hop, -1 if there is none
 	struct routingtable_entry* next;	//pointer to the next routingtable_entry_t in the same routing table slot
 } routingtable_entry_t;
 
-//A routing table is a hash table containing MAX_ROUTINGTABLE_SLOTS slots. Each slot is a linked list of routing entries.
+//A routing table is a hash table containing slotNum slots. Each slot is a linked list of routing entries.
+//slotNum is ROUTINGTABLE_SLOTS_PER_NODE times the number of nodes in the overlay.
 typedef struct routingtable {
-	routingtable_entry_t* hash[MAX_ROUTINGTABLE_SLOTS];
+	int slotNum;			//number of slots
+	routingtable_entry_t** hash;	//array of slotNum slots
 } routingtable_t;
 
 //This is the hash function used the by the routing table
-//It takes the hash key - destination node ID as input, 
+//It takes the hash key - destination node ID and the number of slots as input, 
 //and returns the hash value - slot number for this destination node ID.
-//
-//You can copy makehash() implementation below directly to routingtable.c:
-//int makehash(int node) {
-//	return node%MAX_ROUTINGTABLE_ENTRIES;
-//}
-//
-int makehash(int node); 
+int makehash(int node, int slotNum); 
 
 //This function creates a routing table dynamically.
 //All the entries in the table are initialized to NULL pointers.
@@ -52,10 +55,22 @@ void routingtable_destroy(routingtable_t* routingtable);
 //Then append the routing entry to the linked list in that slot.
 void routingtable_setnextnode(routingtable_t* routingtable, int destNodeID, int nextNodeID);
 
+//This function sets the pathNum equal-cost next hops of the given destination in the routing table, in the same way
+//as routingtable_setnextnode(). nextNodeIDs[0] becomes the next hop returned by routingtable_getnextnode().
+//At most ECMP_MAX_PATHS next hops are kept.
+void routingtable_setnextnodes(routingtable_t* routingtable, int destNodeID, const int* nextNodeIDs, int pathNum);
+
+//This function sets the backup next hop of the given destination in the routing table, -1 for none.
+//If the destination has no routing entry, return -1, otherwise return 1.
+int routingtable_setbackupnode(routingtable_t* routingtable, int destNodeID, int backupNodeID);
+
+//This function removes the routing entry of the given destination from the routing table, if there is one.
+void routingtable_removenode(routingtable_t* routingtable, int destNodeID);
+
 //This function looks up the destNodeID in the routing table.
 //Since routing table is a hash table, this opeartion has O(1) time complexity.
 //To find a routing entry for a destination node, you should first use the hash function makehash() to get the slot number and then go through the linked list in that slot to search the routing entry.
-//If the destNodeID is found, return the nextNodeID for this destination node.
+//If the destNodeID is found, return the nextNodeID (the first of the equal-cost next hops) for this destination node.
 //If the destNodeID is not found, return -1.
 int routingtable_getnextnode(routingtable_t* routingtable, int destNodeID);
 
@@ -6,54 +6,46 @@
 
 #include "neighbortable.h"
 
-//This function first creates a neighbor table dynamically. It then parses the topology/topology.dat file and fill the nodeID and nodeIP fields in all the entries, initialize conn field as -1 .
+//This function first creates a neighbor table dynamically. It then takes the neighbors from the topology (see topology/topology.h) and fill the nodeID and nodeIP fields in all the entries, initialize conn field as -1 .
 //return the created neighbor table
 nbr_entry_t* nt_create()
 {
-    FILE *fp;
-    if ((fp = fopen("../topology/topology.dat", "r")) == NULL) {
-        printf("Cannot find topology.dat!\n");
-        return NULL;
-    }
-    
-    char my_hostname[HOSTNAME_LENGTH];
-    if (gethostname(my_hostname, sizeof(my_hostname)) < 0) {
-        printf("Cannot get my hostname!\n");
-        return NULL;
-    }
-    
-    char *nbr_name_list[MAX_NODE_NUM];
-    memset(nbr_name_list, 0, sizeof(nbr_name_list));
-    
-    char line[256];
-    int nbrNum = 0;
-    while (fgets(line, sizeof(line), fp)) {
-        // parse 1st hostname in this line
-        char * temp = strtok(line, " ");
-        if (strcmp(my_hostname, temp) == 0){
-            nbr_name_list[nbrNum] = (char *)malloc(HOSTNAME_LENGTH);
-            strcpy(nbr_name_list[nbrNum], strtok(NULL, " "));
-            nbrNum++;
-            continue;
-        }
-        // parse 2nd hostname in this line
-        else if (strcmp(my_hostname, strtok(NULL, " ")) == 0){
-            nbr_name_list[nbrNum] = (char *)malloc(HOSTNAME_LENGTH);
-            strcpy(nbr_name_list[nbrNum], temp);
-            nbrNum++;
-        }
-    }
+    int nbrNum = topology_getNbrNum();
+    int* nbrArray = topology_getNbrArray();
     
-    nbr_entry_t * nbr_entry_list = (nbr_entry_t *)malloc(sizeof(nbr_entry_t) * nbrNum);
+    nbr_entry_t * nbr_entry_list = (nbr_entry_t *)malloc(sizeof(nbr_entry_t) * (nbrNum + 1));
     for (int i = 0; i < nbrNum; i++){
+        struct in_addr addr;
         nbr_entry_list[i].conn = -1;
-        nbr_entry_list[i].nodeID = topology_getNodeIDfromname(nbr_name_list[i]);
-        struct hostent *host = gethostbyname(nbr_name_list[i]);
-        memmove(&nbr_entry_list[i].nodeIP, host->h_addr_list[0], sizeof(struct in_addr));
-        
-        free(nbr_name_list[i]);
-        nbr_name_list[i] = NULL;
+        nbr_entry_list[i].nodeID = nbrArray[i];
+        topology_getNodeIP(nbrArray[i], &addr);
+        nbr_entry_list[i].nodeIP = addr.s_addr;
+        nbr_entry_list[i].nodePort = topology_getNodePort(nbrArray[i]);
+        nbr_entry_list[i].baseCost = topology_getCost(topology_getMyNodeID(), nbrArray[i]);
+        nbr_entry_list[i].cost = nbr_entry_list[i].baseCost;
+        nbr_entry_list[i].srtt = 0;
+        nbr_entry_list[i].throughput = 0;
+        nbr_entry_list[i].sentBytes = 0;
+        nbr_entry_list[i].lastSentBytes = 0;
+        nbr_entry_list[i].probeSeq = 0;
+        nbr_entry_list[i].lastHeard = 0;
+        nbr_entry_list[i].reactor = 0;
+        nbr_entry_list[i].connecting = -1;
+        nbr_entry_list[i].retryTime = 0;
+        nbr_entry_list[i].retryDelay = 0;
+        nbr_entry_list[i].sendBuf = (char *)malloc(OVERLAY_SENDBUF_SIZE);
+        nbr_entry_list[i].sendHead = 0;
+        nbr_entry_list[i].sendTail = 0;
+        nbr_entry_list[i].sendArmed = 0;
+        nbr_entry_list[i].queuedPkts = 0;
+        nbr_entry_list[i].droppedPkts = 0;
+        nbr_entry_list[i].resync = 0;
+        nbr_entry_list[i].waitedPkts = 0;
+        nbr_entry_list[i].maxDepth = 0;
+        pthread_mutex_init(&nbr_entry_list[i].sendMutex, NULL);
+        pthread_cond_init(&nbr_entry_list[i].sendCond, NULL);
     }
+    free(nbrArray);
     
     return nbr_entry_list;
 }
@@ -64,8 +56,15 @@ void nt_destroy(nbr_entry_t* nt)
     int nbrNum = topology_getNbrNum();
     for (int i = 0; i < nbrNum; i++){
         if (nt[i].conn != -1){
+            frame_release(nt[i].conn);
             close(nt[i].conn);
         }
+        if (nt[i].connecting != -1){
+            close(nt[i].connecting);
+        }
+        free(nt[i].sendBuf);
+        pthread_mutex_destroy(&nt[i].sendMutex);
+        pthread_cond_destroy(&nt[i].sendCond);
     }
     free(nt);
     return;
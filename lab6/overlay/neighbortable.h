@@ -7,8 +7,10 @@
 #ifndef NEIGHBORTABLE_H 
 #define NEIGHBORTABLE_H
 #include <arpa/inet.h>
+#include <pthread.h>
 #include "../topology/topology.h"
 #include "../common/constants.h"
+#include "../common/frame.h"
 
 //neighbor table entry definition
 //a neighbor table contains n entries where n is the number of neighbors
@@ -17,11 +19,35 @@
 typedef struct neighborentry {
   int nodeID;	        //neighbor's node ID
   in_addr_t nodeIP;     //neighbor's IP address
+  int nodePort;         //port the neighbor's ON process listens on
   int conn;	        //TCP connection's socket descriptor to the neighbor
+  unsigned int baseCost;	//direct link cost in the topology
+  unsigned int cost;	//measured link cost last reported to the SNP process, INFINITE_COST once the link is reported down
+  unsigned int srtt;	//smoothed RTT in microseconds, 0 until the first probe comes back
+  unsigned int throughput;	//smoothed bytes per second sent to the neighbor
+  unsigned long long sentBytes;	//bytes sent to the neighbor
+  unsigned long long lastSentBytes;	//sentBytes when the throughput was last measured
+  unsigned int probeSeq;	//number of the last probe sent
+  unsigned int lastHeard;	//time the last packet was received from the neighbor in microseconds, it wraps around
+  int reactor;		//reactor thread that serves the connection, see overlay.c
+  int connecting;	//socket of the connection being made again to the neighbor by the probe thread, -1 if none
+  unsigned int retryTime;	//time in microseconds the connection being made times out, or of the next attempt, it wraps around
+  unsigned int retryDelay;	//milliseconds to wait after the next failed attempt, 0 if the next attempt is made at once
+  char* sendBuf;	//frames waiting to be written to the connection, the bytes in sendBuf[sendHead, sendTail)
+  int sendHead;
+  int sendTail;
+  int sendArmed;	//set while the reactor waits for the connection to become writable
+  pthread_mutex_t sendMutex;	//protects the send buffer and the changes of conn
+  pthread_cond_t sendCond;	//signaled when room is made in the send buffer or the connection is closed
+  unsigned long long queuedPkts;	//packets put in the send buffer
+  unsigned long long droppedPkts;	//packets dropped because the send buffer was full
+  int resync;		//set when a route update or an LSA to the neighbor is dropped, until the SNP process is asked to send them again
+  unsigned long long waitedPkts;	//packets that had to wait for room in the send buffer
+  int maxDepth;		//largest number of bytes waiting in the send buffer
 } nbr_entry_t;
 
 
-//This function first creates a neighbor table dynamically. It then parses the topology/topology.dat file and fill the nodeID and nodeIP fields in all the entries, initialize conn field as -1 .
+//This function first creates a neighbor table dynamically. It then takes the neighbors from the topology (see topology/topology.h) and fill the nodeID and nodeIP fields in all the entries, initialize conn field as -1 .
 //return the created neighbor table
 nbr_entry_t* nt_create();
 
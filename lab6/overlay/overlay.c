@@ -1,15 +1,19 @@
 //FILE: overlay/overlay.c
 //
 //Description: this file implements a ON process 
-//A ON process first connects to all the neighbors and then starts listen_to_neighbor threads each of which keeps receiving the incoming packets from a neighbor and forwarding the received packets to the SNP process. Then ON process waits for the connection from SNP process. After a SNP process is connected, the ON process keeps receiving sendpkt_arg_t structures from the SNP process and sending the received packets out to the overlay network. 
+//A ON process serves the TCP connections to all its neighbors with a few epoll reactor threads (see nbr_reactor()). The connections are non-blocking, each one has a receive buffer in the frame layer and a send buffer in the neighbor table. A reactor keeps receiving the incoming packets from its neighbors and forwarding the received packets to the SNP process, and writes out the send buffers when the connections can take more bytes. The packets for the SNP process are put into one queue and written to the SNP process in batches by a single delivery thread (see snp_delivery()). The ON process opens its port for the neighbors with larger node IDs and connects to the neighbors with smaller node IDs. Then ON process waits for the connection from SNP process. After a SNP process is connected, the ON process keeps receiving sendpkt_arg_t structures from the SNP process and sending the received packets out to the overlay network. 
 //
 //Date: April 28,2008
 
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <string.h>
 #include <pthread.h>
@@ -19,17 +23,39 @@
 #include <signal.h>
 #include <sys/utsname.h>
 #include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #include "../common/constants.h"
 #include "../common/pkt.h"
+#include "../common/ipc.h"
+#include "../common/log.h"
+#include "../common/config.h"
 #include "overlay.h"
 #include "../topology/topology.h"
 #include "neighbortable.h"
+#include "pktqueue.h"
 
 //you should start the ON processes on all the overlay hosts within this period of time
 #define OVERLAY_START_DELAY 60
 //#define OVERLAY_START_DELAY 10
 
+//number of events a reactor takes from epoll at a time
+#define OVERLAY_EPOLL_EVENTS 64
+
+//kinds of the sockets watched by the reactors, kept in the high 32 bits of the epoll event data
+#define OVERLAY_EV_NBR 0	//connection to the neighbor nt[i], the low 32 bits are i
+#define OVERLAY_EV_LISTEN 1	//listening socket for the neighbors, the low 32 bits are the socket
+#define OVERLAY_EV_PENDING 2	//connection from a neighbor that hasn't sent its node ID yet, the low 32 bits are the socket
+
+//an epoll reactor thread
+typedef struct reactor {
+    int epfd;			//epoll instance of the reactor
+    int* again;			//neighbors that used up their read budget, they are served again before the reactor waits
+    int againNum;
+} reactor_t;
+
 /**************************************************************/
 //declare global variables
 /**************************************************************/
@@ -38,70 +64,532 @@
 nbr_entry_t* nt; 
 //declare the TCP connection to SNP process as global variable
 int network_conn; 
+//the reactor threads
+static reactor_t* reactors;
+static int reactorNum;
+//the packets waiting to be delivered to the SNP process
+static pktqueue_t* deliveryq;
+//the delivery thread is the only one that closes the connection to the SNP process, waitNetwork() asks it to with snp_closing
+//and waits on snp_closed until it is done, network_conn is changed with snp_mutex held
+static pthread_mutex_t snp_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snp_closed = PTHREAD_COND_INITIALIZER;
+static int snp_closing;
 
 
 /**************************************************************/
 //implementation overlay functions
 /**************************************************************/
 
-// This thread opens a TCP port on CONNECTION_PORT and waits for the incoming connection from all the neighbors that have a larger node ID than my nodeID,
-// After all the incoming connections are established, this thread terminates 
-void* waitNbrs(void* arg) {
-    //put your code here
+//return the time in microseconds on the monotonic clock, it wraps around
+static unsigned int now_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned int)(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+}
+
+//watch a socket in the epoll instance of a reactor, or change the events watched (op is EPOLL_CTL_ADD or EPOLL_CTL_MOD)
+static int reactor_watch(int r, int op, int fd, int kind, int value, uint32_t events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u64 = ((uint64_t)kind << 32) | (uint32_t)value;
+    if (epoll_ctl(reactors[r].epfd, op, fd, &ev) < 0){
+        perror("epoll_ctl error");
+        return -1;
+    }
+    return 1;
+}
+
+//write out the send buffer of the neighbor nt[i] as far as the connection takes it, it is called with sendMutex held
+//the reactor is asked to watch the connection for writability while bytes are left, and not once they are all written
+//if the connection fails the buffered bytes are dropped, the reactor closes the connection when it sees the error
+static void nbr_flush(int i) {
+    while (nt[i].sendHead < nt[i].sendTail){
+        ssize_t n = send(nt[i].conn, nt[i].sendBuf + nt[i].sendHead, nt[i].sendTail - nt[i].sendHead, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0){
+            nt[i].sendHead += n;
+        }
+        else if (n < 0 && errno == EINTR){
+            continue;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            break;
+        }
+        else {
+            nt[i].sendHead = nt[i].sendTail;
+        }
+    }
+    if (nt[i].sendHead == nt[i].sendTail){
+        nt[i].sendHead = 0;
+        nt[i].sendTail = 0;
+        pthread_cond_broadcast(&nt[i].sendCond);
+    }
+    int armed = nt[i].sendHead < nt[i].sendTail;
+    if (armed != nt[i].sendArmed){
+        reactor_watch(nt[i].reactor, EPOLL_CTL_MOD, nt[i].conn, OVERLAY_EV_NBR, i, armed ? EPOLLIN | EPOLLOUT : EPOLLIN);
+        nt[i].sendArmed = armed;
+    }
+}
+
+//send a packet to the neighbor nt[i], the bytes sent are counted for the throughput of the link
+//the packet is put in the send buffer of the connection and written out as far as the connection takes it right away,
+//the rest is written by the reactor. If the send buffer is full, wait for room if wait is set, otherwise drop the packet.
+//The SNP data packets leave the last OVERLAY_SENDBUF_RESERVE bytes of the send buffer to the control packets. A route update
+//or an LSA that doesn't fit even so is dropped, and the SNP process is asked to send its routing state again (see probe_daemon()).
+//A packet waits at most the detection time, a link that takes longer is down (see probe_daemon()) and the packet is dropped.
+//A reactor thread must not wait, it is the one that makes room.
+//Return 1 if the packet is sent, otherwise return -1.
+static int nbr_sendpkt(int i, snp_pkt_t* pkt, int wait) {
+    int len = SNP_PKT_LEN(pkt);
+    // room for the frame header and the trailer in any frame mode
+    int need = len + FRAME_HDR_LEN + 2;
+    int limit = pkt->header.type == SNP ? OVERLAY_SENDBUF_SIZE - OVERLAY_SENDBUF_RESERVE : OVERLAY_SENDBUF_SIZE;
+    pthread_mutex_lock(&nt[i].sendMutex);
+    if (nt[i].conn != -1 && limit - (nt[i].sendTail - nt[i].sendHead) < need && wait){
+        nt[i].waitedPkts++;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += config_getDetectTime() / 1000;
+        deadline.tv_nsec += (config_getDetectTime() % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L){
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (nt[i].conn != -1 && limit - (nt[i].sendTail - nt[i].sendHead) < need){
+            if (pthread_cond_timedwait(&nt[i].sendCond, &nt[i].sendMutex, &deadline) == ETIMEDOUT){
+                break;
+            }
+        }
+    }
+    if (nt[i].conn == -1){
+        pthread_mutex_unlock(&nt[i].sendMutex);
+        return -1;
+    }
+    if (limit - (nt[i].sendTail - nt[i].sendHead) < need){
+        nt[i].droppedPkts++;
+        if (pkt->header.type == ROUTE_UPDATE || pkt->header.type == LINK_STATE){
+            nt[i].resync = 1;
+        }
+        pthread_mutex_unlock(&nt[i].sendMutex);
+        return -1;
+    }
+    if (OVERLAY_SENDBUF_SIZE - nt[i].sendTail < need){
+        memmove(nt[i].sendBuf, nt[i].sendBuf + nt[i].sendHead, nt[i].sendTail - nt[i].sendHead);
+        nt[i].sendTail -= nt[i].sendHead;
+        nt[i].sendHead = 0;
+    }
+    nt[i].sendTail += frame_pack(nt[i].sendBuf + nt[i].sendTail, OVERLAY_SENDBUF_SIZE - nt[i].sendTail, pkt, len);
+    nt[i].queuedPkts++;
+    if (nt[i].sendTail - nt[i].sendHead > nt[i].maxDepth){
+        nt[i].maxDepth = nt[i].sendTail - nt[i].sendHead;
+    }
+    __atomic_fetch_add(&nt[i].sentBytes, len, __ATOMIC_RELAXED);
+    // while the reactor waits for writability the bytes before these are still waiting, the reactor writes them all
+    if (!nt[i].sendArmed){
+        nbr_flush(i);
+    }
+    pthread_mutex_unlock(&nt[i].sendMutex);
+    return 1;
+}
+
+//hand a packet received by a reactor to the delivery thread, which forwards it to the SNP process
+//while the queue is full the reactor sleeps, it stops reading from its neighbors until the SNP process catches up
+//the probe thread must not wait, it puts its reports into the queue itself (see probe_daemon())
+static void snp_deliver(snp_pkt_t* pkt) {
+    pktqueue_pushwait(deliveryq, pkt);
+}
+
+//update the smoothed RTT of the link to the neighbor nt[i] with a probe that came back
+//a probe that took longer than the detection time was sent before the link went down, it is not counted
+static void nbr_rttsample(int i, const pkt_probe_t* probe) {
+    unsigned int sample = now_us() - probe->sendTime;
+    if (sample >= config_getDetectTime() * 1000U){
+        return;
+    }
+    unsigned int srtt = __atomic_load_n(&nt[i].srtt, __ATOMIC_RELAXED);
+    if (srtt == 0){
+        srtt = sample > 0 ? sample : 1;
+    }
+    else {
+        srtt = (unsigned int)((long long)srtt + ((long long)sample - srtt) / LINKCOST_SMOOTHING);
+    }
+    __atomic_store_n(&nt[i].srtt, srtt, __ATOMIC_RELAXED);
+}
+
+//return the measured cost of the link to the neighbor nt[i], from its cost in the topology, its smoothed RTT and its load
+//the extra cost is bounded (see LINKCOST_MAX_EXTRA in constants.h) and the cost stays below the route infinity,
+//a link is not taken down by its measured cost
+static unsigned int nbr_measuredcost(int i) {
+    unsigned long long extra = __atomic_load_n(&nt[i].srtt, __ATOMIC_RELAXED) / LINKCOST_RTT_UNIT;
+    // load in percent of the link capacity
+    unsigned long long load = (unsigned long long)nt[i].throughput * 100 / LINKCOST_LINK_CAPACITY;
+    if (load > 100){
+        load = 100;
+    }
+    if (load > LINKCOST_LOAD_KNEE){
+        extra += (load - LINKCOST_LOAD_KNEE) * LINKCOST_LOAD_EXTRA / (100 - LINKCOST_LOAD_KNEE);
+    }
+    if (extra > LINKCOST_MAX_EXTRA){
+        extra = LINKCOST_MAX_EXTRA;
+    }
+    if (extra > nt[i].baseCost){
+        extra = nt[i].baseCost;
+    }
+    unsigned long long cost = nt[i].baseCost + extra;
+    if (cost >= config_getInfinity()){
+        cost = config_getInfinity() - 1;
+    }
+    return (unsigned int)cost;
+}
+
+//close the connection to the neighbor nt[i], the packets waiting in its send buffer are dropped
+//only the reactor that serves the connection closes it, the link is declared down at the next heartbeat
+static void nbr_close(int i) {
+    pthread_mutex_lock(&nt[i].sendMutex);
+    int conn = nt[i].conn;
+    epoll_ctl(reactors[nt[i].reactor].epfd, EPOLL_CTL_DEL, conn, NULL);
+    nt[i].conn = -1;
+    nt[i].sendHead = 0;
+    nt[i].sendTail = 0;
+    nt[i].sendArmed = 0;
+    pthread_cond_broadcast(&nt[i].sendCond);
+    pthread_mutex_unlock(&nt[i].sendMutex);
+    frame_release(conn);
+    close(conn);
+}
+
+//ask the reactor that serves the neighbor nt[i] to close its connection, the reactor sees the end of the connection and closes it
+static void nbr_shutdown(int i) {
+    pthread_mutex_lock(&nt[i].sendMutex);
+    // the reactor clears conn with sendMutex held before it closes the connection, so it is still open here
+    if (nt[i].conn != -1){
+        shutdown(nt[i].conn, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&nt[i].sendMutex);
+}
+
+//handle a packet received from the neighbor nt[i] by forwarding it to the SNP process
+//A link probe is sent straight back to the neighbor, and a probe that comes back updates the smoothed RTT of the link, they are not forwarded.
+//Every packet received keeps the link alive, see probe_daemon().
+static void nbr_handlepkt(int i, snp_pkt_t* pkt) {
+    __atomic_store_n(&nt[i].lastHeard, now_us(), __ATOMIC_RELAXED);
+    LOG_DEBUG("Overlay: received a snp_pkt_t packet from node %d!\n", nt[i].nodeID);
+    if (pkt->header.type == LINK_PROBE){
+        pkt->header.type = LINK_PROBE_REPLY;
+        pkt->header.dest_nodeID = pkt->header.src_nodeID;
+        pkt->header.src_nodeID = topology_getMyNodeID();
+        nbr_sendpkt(i, pkt, 0);
+        return;
+    }
+    if (pkt->header.type == LINK_PROBE_REPLY){
+        if (pkt->header.length >= sizeof(pkt_probe_t)){
+            nbr_rttsample(i, (pkt_probe_t *)pkt->data);
+        }
+        return;
+    }
+    snp_deliver(pkt);
+}
+
+//hand the connection conn from the neighbor with the given node ID (or to it) to the reactor that serves the neighbor
+//the connection is made non-blocking, and the packets the frame layer has already buffered from it are handled first
+//Return 1 if the connection is attached, otherwise close it and return -1.
+static int nbr_attach(int nodeID, int conn) {
+    int nbrNum = topology_getNbrNum();
+    int i;
+    for (i = 0; i < nbrNum; i++){
+        if (nt[i].nodeID == nodeID){
+            break;
+        }
+    }
+    if (i == nbrNum || nt[i].conn != -1){
+        frame_release(conn);
+        close(conn);
+        return -1;
+    }
+    fcntl(conn, F_SETFL, fcntl(conn, F_GETFL, 0) | O_NONBLOCK);
+    __atomic_store_n(&nt[i].lastHeard, now_us(), __ATOMIC_RELAXED);
+    // the send buffer is only written out by the reactor until the connection is watched, it is asked to wait for writability
+    pthread_mutex_lock(&nt[i].sendMutex);
+    nt[i].sendHead = 0;
+    nt[i].sendTail = 0;
+    nt[i].sendArmed = 1;
+    nt_addconn(nt, nodeID, conn);
+    pthread_mutex_unlock(&nt[i].sendMutex);
+    snp_pkt_t pkt;
+    int ret;
+    while ((ret = pollpkt(&pkt, conn)) > 0){
+        nbr_handlepkt(i, &pkt);
+    }
+    if (ret < 0 || reactor_watch(nt[i].reactor, EPOLL_CTL_ADD, conn, OVERLAY_EV_NBR, i, EPOLLIN | EPOLLOUT) < 0){
+        LOG_ERROR("Overlay: lose coonnection with node %d!\n", nodeID);
+        pthread_mutex_lock(&nt[i].sendMutex);
+        nt[i].conn = -1;
+        nt[i].sendArmed = 0;
+        pthread_cond_broadcast(&nt[i].sendCond);
+        pthread_mutex_unlock(&nt[i].sendMutex);
+        frame_release(conn);
+        close(conn);
+        return -1;
+    }
+    return 1;
+}
+
+//receive the packets from the neighbor nt[i] served by the reactor r, at most OVERLAY_READ_BUDGET of them,
+//so that a busy neighbor doesn't hold up the others. A neighbor that used up its budget is served again before the reactor waits.
+static void nbr_read(reactor_t* r, int i) {
+    snp_pkt_t pkt;
+    for (int n = 0; n < OVERLAY_READ_BUDGET; n++){
+        int ret = pollpkt(&pkt, nt[i].conn);
+        if (ret == 0){
+            return;
+        }
+        if (ret < 0){
+            LOG_ERROR("Overlay: lose coonnection with node %d!\n", nt[i].nodeID);
+            nbr_close(i);
+            return;
+        }
+        nbr_handlepkt(i, &pkt);
+    }
+    r->again[r->againNum++] = i;
+}
+
+//a neighbor connected to the listening socket, it is watched until it sends its node ID
+static void nbr_accept(int r, int sockfd) {
+    int conn;
+    struct sockaddr_in client_addr;
+    socklen_t sin_size = sizeof(struct sockaddr_in);
+    while ((conn = accept(sockfd, (struct sockaddr *)&(client_addr), &sin_size)) != -1){
+        fcntl(conn, F_SETFL, fcntl(conn, F_GETFL, 0) | O_NONBLOCK);
+        frame_open(conn);
+        if (reactor_watch(r, EPOLL_CTL_ADD, conn, OVERLAY_EV_PENDING, conn, EPOLLIN) < 0){
+            frame_release(conn);
+            close(conn);
+        }
+        sin_size = sizeof(struct sockaddr_in);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+        perror("accept error\n");
+    }
+}
+
+//a neighbor that connected sent its node ID, or closed the connection
+static void nbr_identify(int r, int conn) {
+    void* body;
+    int len = frame_poll(conn, &body);
+    if (len == FRAME_AGAIN){
+        return;
+    }
+    epoll_ctl(reactors[r].epfd, EPOLL_CTL_DEL, conn, NULL);
+    uint32_t nbrID;
+    if (len != sizeof(nbrID)){
+        LOG_WARN("Overlay: unknown node connected!\n");
+        frame_release(conn);
+        close(conn);
+        return;
+    }
+    memcpy(&nbrID, body, sizeof(nbrID));
+    nbrID = ntohl(nbrID);
+    if (nbr_attach((int)nbrID, conn) < 0){
+        LOG_WARN("Overlay: node %d connected, but it is not a neighbor or it is already connected!\n", (int)nbrID);
+        return;
+    }
+    LOG_INFO("Overlay: neighbor node %d has joined!\n", (int)nbrID);
+}
+
+//tell the neighbor nt[i] who I am on the connection sockfd just made to it, and hand the connection to its reactor
+//Return 1 if the connection is attached, otherwise close it and return -1.
+static int nbr_introduce(int i, int sockfd) {
+    frame_open(sockfd);
+    uint32_t myID = htonl(topology_getMyNodeID());
+    if (frame_send(sockfd, &myID, sizeof(myID)) < 0) {
+        perror("connect error\n");
+        frame_release(sockfd);
+        close(sockfd);
+        return -1;
+    }
+    return nbr_attach(nt[i].nodeID, sockfd);
+}
+
+//an attempt to connect to the neighbor nt[i] failed, the next one waits the detection time, doubled after each failure
+static void nbr_retrylater(int i, unsigned int now) {
+    nt[i].retryDelay = nt[i].retryDelay == 0 ? config_getDetectTime() : nt[i].retryDelay * 2;
+    if (nt[i].retryDelay > LINK_RETRY_MAX_TIME){
+        nt[i].retryDelay = LINK_RETRY_MAX_TIME;
+    }
+    nt[i].retryTime = now + nt[i].retryDelay * 1000;
+}
+
+//connect again to the neighbor nt[i] with a smaller node ID, whose connection is lost or was never made, see LINK_RETRY_MAX_TIME in constants.h
+//It is called by the probe thread at each heartbeat, so the connection is made with a non-blocking connect() and checked
+//at the next heartbeats. Once it is established it is handed to the reactor that serves the neighbor.
+static void nbr_reconnect(int i, unsigned int now) {
+    if (nt[i].connecting == -1){
+        if (nt[i].retryDelay != 0 && (int)(now - nt[i].retryTime) < 0){
+            return;
+        }
+        int sockfd;
+        if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+            perror("socket creation error\n");
+            nbr_retrylater(i, now);
+            return;
+        }
+        fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+        
+        struct sockaddr_in server_addr;
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(nt[i].nodePort);
+        server_addr.sin_addr.s_addr = nt[i].nodeIP;
+        
+        if (connect(sockfd, (struct sockaddr *)&(server_addr), sizeof(struct sockaddr)) == -1 && errno != EINPROGRESS) {
+            close(sockfd);
+            nbr_retrylater(i, now);
+            return;
+        }
+        nt[i].connecting = sockfd;
+        nt[i].retryTime = now + config_getDetectTime() * 1000;
+    }
+    
+    struct pollfd pfd;
+    pfd.fd = nt[i].connecting;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) == 0){
+        if ((int)(now - nt[i].retryTime) >= 0){
+            close(nt[i].connecting);
+            nt[i].connecting = -1;
+            nbr_retrylater(i, now);
+        }
+        return;
+    }
+    int sockfd = nt[i].connecting;
+    nt[i].connecting = -1;
+    int err = 0;
+    socklen_t errLen = sizeof(err);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &errLen) < 0 || err != 0){
+        close(sockfd);
+        nbr_retrylater(i, now);
+        return;
+    }
+    if (nbr_introduce(i, sockfd) < 0){
+        nbr_retrylater(i, now);
+        return;
+    }
+    nt[i].retryDelay = 0;
+    LOG_INFO("Overlay: successfully connected to neighbor node %d again!\n", nt[i].nodeID);
+}
+
+//Each reactor thread serves the connections to a part of the neighbors (the neighbors nt[i] with nt[i].reactor equal to its number)
+//with epoll. It receives the packets from the neighbors and handles them as nbr_handlepkt(), writes out the send buffers of
+//the connections that can take more bytes, and closes the connections that are lost. Reactor 0 also accepts the connections
+//from the neighbors on the listening socket, see listenNbrs().
+void* nbr_reactor(void* arg) {
+    reactor_t* r = &reactors[(long)arg];
+    struct epoll_event events[OVERLAY_EPOLL_EVENTS];
+    int nbrNum = topology_getNbrNum();
+    int* serving = (int *)malloc(sizeof(int) * (nbrNum + 1));
+    while (1){
+        // the neighbors that used up their read budget have more packets waiting, don't wait for new events then
+        int n = epoll_wait(r->epfd, events, OVERLAY_EPOLL_EVENTS, r->againNum > 0 ? 0 : -1);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            perror("epoll_wait error\n");
+            exit(1);
+        }
+        int servingNum = r->againNum;
+        memcpy(serving, r->again, sizeof(int) * servingNum);
+        r->againNum = 0;
+        for (int k = 0; k < n; k++){
+            int kind = (int)(events[k].data.u64 >> 32);
+            int value = (int)(uint32_t)events[k].data.u64;
+            if (kind == OVERLAY_EV_LISTEN){
+                nbr_accept((long)arg, value);
+                continue;
+            }
+            if (kind == OVERLAY_EV_PENDING){
+                nbr_identify((long)arg, value);
+                continue;
+            }
+            if (nt[value].conn == -1){
+                continue;
+            }
+            if (events[k].events & EPOLLOUT){
+                pthread_mutex_lock(&nt[value].sendMutex);
+                nbr_flush(value);
+                pthread_mutex_unlock(&nt[value].sendMutex);
+            }
+            if (events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+                // a neighbor already waiting to be served again is served once
+                int k2;
+                for (k2 = 0; k2 < servingNum && serving[k2] != value; k2++);
+                if (k2 == servingNum){
+                    nbr_read(r, value);
+                }
+            }
+        }
+        for (int k = 0; k < servingNum; k++){
+            if (nt[serving[k]].conn != -1){
+                nbr_read(r, serving[k]);
+            }
+        }
+    }
+    
+    free(serving);
+    pthread_exit(0);
+}
+
+// This function opens a TCP port on my node's port in the topology (CONNECTION_PORT by default) for the incoming connections from the neighbors that have a larger node ID than my nodeID.
+// The connections are accepted by reactor 0. A neighbor sends its node ID as the first frame on the connection, several neighbors may connect from the same IP address.
+// A neighbor that restarts connects again, its new connection is accepted once the old one is closed.
+// Return 1 if the port is opened, otherwise return -1
+int listenNbrs() {
     int sockfd;
     // create a new socket
     if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
         perror(" socket creation error\n");
-        exit(1);
+        return -1;
     }
     
-    struct sockaddr_in server_addr, client_addr;
+    struct sockaddr_in server_addr;
+    int port = topology_getNodePort(topology_getMyNodeID());
+    if (port < 0) {
+        port = CONNECTION_PORT;
+    }
     
     /* Prepare the socket address structure of the server */
     server_addr.sin_family = AF_INET;       // host byte order
-    server_addr.sin_port = htons(CONNECTION_PORT);   // short, network byte order
+    server_addr.sin_port = htons(port);   // short, network byte order
     server_addr.sin_addr.s_addr = htonl(INADDR_ANY); // automatically fill with my IP address "localhost"
     memset(&(server_addr.sin_zero), '\0', 8); // zero the rest of the struct
     
+    // a restarted ON process can open its port again while the connections of the old one are in TIME_WAIT
+    int on = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    
     if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr)) == -1) {
         perror("bind error\n");
-        exit(1);
+        return -1;
     }
     
-    if (listen(sockfd, MAX_NODE_NUM) == -1) {
+    if (listen(sockfd, topology_getNbrNum() + 1) == -1) {
         perror("listen error\n");
-        exit(1);
-    }
-    
-    int conn;
-    socklen_t sin_size;
-    sin_size = sizeof(struct sockaddr_in);
-    
-    int nbrNum = topology_getNbrNum();
-    int myNodeID = topology_getMyNodeID();
-    for (int i = 0; i < nbrNum; i++){
-        if (nt[i].nodeID <= myNodeID){
-            continue;
-        }
-        printf("Overlay: waiting for my neighbor!\n");
-        if ((conn = accept(sockfd, (struct sockaddr *)&(client_addr), &sin_size)) == -1) {
-            perror("accept error\n");
-            exit(1);
-        }
-        nt_addconn(nt, topology_getNodeIDfromip(&(client_addr.sin_addr)), conn);
-        printf("Overlay: neighbor node %d has joined!\n", nt[i].nodeID);
+        return -1;
     }
     
-    // terminate this thread
-    pthread_detach(pthread_self());
-    pthread_exit(0);
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+    LOG_INFO("Overlay: waiting for my neighbor!\n");
+    return reactor_watch(0, EPOLL_CTL_ADD, sockfd, OVERLAY_EV_LISTEN, sockfd, EPOLLIN);
 }
 
 // This function connects to all the neighbors that have a smaller node ID than my nodeID
+// The connections are handed to the reactors, a neighbor that can't be connected stays down until the probe thread connects to it, see nbr_reconnect().
 // After all the outgoing connections are established, return 1, otherwise return -1
 int connectNbrs() {
     int nbrNum = topology_getNbrNum();
     int myNodeID = topology_getMyNodeID();
+    int ret = 1;
     for (int i = 0; i < nbrNum; i++){
         if (nt[i].nodeID >= myNodeID){
             continue;
@@ -116,104 +604,266 @@ int connectNbrs() {
         struct sockaddr_in server_addr;
         memset(&server_addr, 0, sizeof(server_addr));
         server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(CONNECTION_PORT);
+        server_addr.sin_port = htons(nt[i].nodePort);
         server_addr.sin_addr.s_addr = nt[i].nodeIP;
         
         if ((connect(sockfd, (struct sockaddr *)&(server_addr), sizeof(struct sockaddr))) == -1) {
             perror("connect error\n");
-            return -1;
+            close(sockfd);
+            ret = -1;
+            continue;
         }
         
-        nt_addconn(nt, nt[i].nodeID, sockfd);
-        printf("Overlay: successfully connected to neighbor node %d!\n", nt[i].nodeID);
+        if (nbr_introduce(i, sockfd) < 0) {
+            ret = -1;
+            continue;
+        }
+        
+        LOG_INFO("Overlay: successfully connected to neighbor node %d!\n", nt[i].nodeID);
     }
     
-    return 1;
+    return ret;
 }
 
-//Each listen_to_neighbor thread keeps receiving packets from a neighbor. It handles the received packets by forwarding the packets to the SNP process.
-//all listen_to_neighbor threads are started after all the TCP connections to the neighbors are established 
-void* listen_to_neighbor(void* arg) {
-    //put your code here
-    int *idx = (int *)arg;
-    snp_pkt_t* pkt;
-    pkt = (snp_pkt_t *)malloc(sizeof(snp_pkt_t));
+//This thread watches and measures the links to the neighbors. Every detection time / LINK_HEARTBEAT_MISSES (see config_getDetectTime())
+//it sends a probe to each neighbor, which is both a heartbeat and an RTT measurement (the RTT is measured by the reactors
+//when the probe comes back). A link whose connection is lost, or that has received nothing for the detection time, is down:
+//it is reported to the SNP process with cost INFINITE_COST, so that the routes through it are withdrawn at once, and a silent
+//connection is closed by its reactor. A down link that is heard from again is reported up with its measured cost.
+//The lost connections to the neighbors with smaller node IDs are made again by this thread, see nbr_reconnect().
+//Every LINKCOST_INTERVAL milliseconds the throughput of each link is measured, and its cost is computed from its cost in the topology,
+//its smoothed RTT and its load relative to the link capacity, see LINKCOST_RTT_UNIT in constants.h. The costs that differ from the ones last reported
+//to the SNP process by more than LINKCOST_HYSTERESIS percent are reported.
+//The changes are sent to the SNP process in one LINK_COST packet, and the neighbors that missed route updates or LSAs in one LINK_RESYNC packet. The packets dropped because a send queue was full are logged at the same time.
+void* probe_daemon(void* arg) {
+    int nbrNum = topology_getNbrNum();
+    int myNodeID = topology_getMyNodeID();
+    snp_pkt_t probe;
+    snp_pkt_t costPkt;
+    snp_pkt_t resyncPkt;
+    memset(&probe.header, 0, sizeof(snp_hdr_t));
+    probe.header.src_nodeID = topology_getMyNodeID();
+    probe.header.type = LINK_PROBE;
+    probe.header.length = sizeof(pkt_probe_t);
+    memset(&costPkt.header, 0, sizeof(snp_hdr_t));
+    costPkt.header.src_nodeID = topology_getMyNodeID();
+    costPkt.header.dest_nodeID = topology_getMyNodeID();
+    costPkt.header.type = LINK_COST;
+    resyncPkt.header = costPkt.header;
+    resyncPkt.header.type = LINK_RESYNC;
     
+    int detectTime = (int)config_getDetectTime() * 1000;
+    unsigned int heartbeat = config_getDetectTime() / LINK_HEARTBEAT_MISSES;
+    struct timespec interval;
+    interval.tv_sec = heartbeat / 1000;
+    interval.tv_nsec = (heartbeat % 1000) * 1000000L;
+    // all the links count as alive when the thread starts
+    unsigned int lastMeasured = now_us();
+    unsigned int lastTick = lastMeasured;
+    // droppedPkts of each neighbor when it was last logged
+    unsigned long long* lastDropped = (unsigned long long *)calloc(nbrNum + 1, sizeof(unsigned long long));
+    for (int i = 0; i < nbrNum; i++){
+        __atomic_store_n(&nt[i].lastHeard, lastMeasured, __ATOMIC_RELAXED);
+    }
     while (1){
+        nanosleep(&interval, NULL);
+        unsigned int now = now_us();
+        if ((int)(now - lastTick) >= detectTime){
+            // this process was not running, the silence of the links is its own, the receiving threads catch up first
+            lastTick = now;
+            continue;
+        }
+        lastTick = now;
+        unsigned int elapsed = now - lastMeasured;
+        int measure = elapsed >= LINKCOST_INTERVAL * 1000U;
+        if (measure){
+            lastMeasured = now;
+        }
+        // the neighbor of each entry of the reports
+        int costNbrs[ROUTEUPDATE_MAX_ENTRIES];
+        int resyncNbrs[ROUTEUPDATE_MAX_ENTRIES];
+        pkt_routeupdate_t *costs = (pkt_routeupdate_t *)costPkt.data;
+        costs->entryNum = 0;
+        pkt_routeupdate_t *resyncs = (pkt_routeupdate_t *)resyncPkt.data;
+        resyncs->entryNum = 0;
+        for (int i = 0; i < nbrNum; i++){
+            if (nt[i].conn == -1 && nt[i].nodeID < myNodeID){
+                nbr_reconnect(i, now);
+            }
+            // a down link is probed as long as its connection is open, it comes back up as soon as the neighbor answers
+            if (nt[i].conn != -1){
+                pkt_probe_t *p = (pkt_probe_t *)probe.data;
+                p->seqNum = ++nt[i].probeSeq;
+                p->sendTime = now_us();
+                probe.header.dest_nodeID = nt[i].nodeID;
+                nbr_sendpkt(i, &probe, 0);
+            }
+            // the SNP process is asked to send the routing packets that were dropped again once the send buffer is out of the reserve
+            pthread_mutex_lock(&nt[i].sendMutex);
+            if (nt[i].resync && nt[i].sendTail - nt[i].sendHead <= OVERLAY_SENDBUF_SIZE - OVERLAY_SENDBUF_RESERVE && resyncs->entryNum < ROUTEUPDATE_MAX_ENTRIES){
+                nt[i].resync = 0;
+                resyncNbrs[resyncs->entryNum] = i;
+                resyncs->entry[resyncs->entryNum].nodeID = nt[i].nodeID;
+                resyncs->entry[resyncs->entryNum].cost = 0;
+                resyncs->entryNum++;
+            }
+            pthread_mutex_unlock(&nt[i].sendMutex);
+            // a change that doesn't fit in the packet is reported at the next heartbeat
+            int room = costs->entryNum < ROUTEUPDATE_MAX_ENTRIES;
+            unsigned int reported = __atomic_load_n(&nt[i].cost, __ATOMIC_RELAXED);
+            // time since the last packet, negative if one came in after now was read
+            int silence = (int)(now - __atomic_load_n(&nt[i].lastHeard, __ATOMIC_RELAXED));
+            if (nt[i].conn == -1 || silence >= detectTime){
+                if (reported != INFINITE_COST && room){
+                    costNbrs[costs->entryNum] = i;
+                    costs->entry[costs->entryNum].nodeID = nt[i].nodeID;
+                    costs->entry[costs->entryNum].cost = INFINITE_COST;
+                    costs->entryNum++;
+                }
+                continue;
+            }
+            if (measure){
+                // throughput since the last measurement
+                unsigned long long sent = __atomic_load_n(&nt[i].sentBytes, __ATOMIC_RELAXED);
+                long long rate = (long long)(sent - nt[i].lastSentBytes) * 1000000 / elapsed;
+                nt[i].lastSentBytes = sent;
+                nt[i].throughput = (unsigned int)((long long)nt[i].throughput + (rate - (long long)nt[i].throughput) / LINKCOST_SMOOTHING);
+                
+                // packets dropped since the last measurement because the send queue was full
+                pthread_mutex_lock(&nt[i].sendMutex);
+                unsigned long long dropped = nt[i].droppedPkts;
+                int depth = nt[i].sendTail - nt[i].sendHead;
+                pthread_mutex_unlock(&nt[i].sendMutex);
+                if (dropped != lastDropped[i]){
+                    LOG_WARN("Overlay: send queue to node %d is full, %llu packets dropped\n", nt[i].nodeID, dropped - lastDropped[i]);
+                    lastDropped[i] = dropped;
+                }
+                LOG_DEBUG("Overlay: send queue to node %d holds %d bytes\n", nt[i].nodeID, depth);
+            }
+            
+            unsigned int cost = nbr_measuredcost(i);
+            unsigned int diff = cost > reported ? cost - reported : reported - cost;
+            if (room && (reported == INFINITE_COST || (measure && diff * 100 > reported * LINKCOST_HYSTERESIS))){
+                costNbrs[costs->entryNum] = i;
+                costs->entry[costs->entryNum].nodeID = nt[i].nodeID;
+                costs->entry[costs->entryNum].cost = cost;
+                costs->entryNum++;
+            }
+        }
         
-        if (recvpkt(pkt, nt[*idx].conn) < 0){
-            printf("Overlay: lose coonnection with node %d!\n", nt[*idx].nodeID);
-            break;
+        // the probe thread doesn't wait for a slow SNP process, the reports are skipped while the delivery queue is full,
+        // and the changes are only taken as reported once they are queued, so they are reported again at the next heartbeat
+        if (costs->entryNum > 0 && network_conn != -1){
+            costPkt.header.length = ROUTEUPDATE_LEN(costs->entryNum);
+            if (pktqueue_push(deliveryq, &costPkt) < 0){
+                LOG_DEBUG("Overlay: delivery queue is full, %d link costs are reported later\n", costs->entryNum);
+                costs->entryNum = 0;
+            }
+        }
+        for (int k = 0; k < costs->entryNum; k++){
+            int i = costNbrs[k];
+            unsigned int cost = costs->entry[k].cost;
+            unsigned int reported = __atomic_load_n(&nt[i].cost, __ATOMIC_RELAXED);
+            __atomic_store_n(&nt[i].cost, cost, __ATOMIC_RELAXED);
+            if (cost == INFINITE_COST){
+                // the RTT is measured again when the link comes back up
+                __atomic_store_n(&nt[i].srtt, 0, __ATOMIC_RELAXED);
+                LOG_WARN("Overlay: link to node %d is down!\n", nt[i].nodeID);
+                // the silent connection is closed, so that the neighbor can connect again if it restarted (see nbr_reconnect())
+                nbr_shutdown(i);
+                continue;
+            }
+            if (reported == INFINITE_COST){
+                LOG_INFO("Overlay: link to node %d is up!\n", nt[i].nodeID);
+            }
+            LOG_INFO("Overlay: link cost to node %d is %u (rtt %u us, %u bytes/s)\n", nt[i].nodeID, cost, nt[i].srtt, nt[i].throughput);
         }
-        printf("Overlay: received a snp_pkt_t packet from node %d!\n", nt[*idx].nodeID);
-        if (forwardpktToSNP(pkt, network_conn) > 0){
-            printf("Overlay: forward a snp_pkt_t packet to local SNP!\n");
+        if (resyncs->entryNum > 0 && network_conn != -1){
+            resyncPkt.header.length = ROUTEUPDATE_LEN(resyncs->entryNum);
+            if (pktqueue_push(deliveryq, &resyncPkt) < 0){
+                for (int k = 0; k < resyncs->entryNum; k++){
+                    pthread_mutex_lock(&nt[resyncNbrs[k]].sendMutex);
+                    nt[resyncNbrs[k]].resync = 1;
+                    pthread_mutex_unlock(&nt[resyncNbrs[k]].sendMutex);
+                }
+            }
         }
     }
     
-    close(nt[*idx].conn);
-    nt[*idx].conn = -1;
-    free(pkt);
+    free(lastDropped);
+    pthread_exit(0);
+}
+
+//This thread delivers the packets received from the neighbors and the link cost reports to the SNP process.
+//The reactors and the probe thread put the packets into the delivery queue (see overlay/pktqueue.h), this thread is the only one
+//that writes to the SNP process: it takes all the waiting packets, up to OVERLAY_DELIVERY_BATCH, and sends them with one system call,
+//in the order they were queued. The packets are dropped while no SNP process is connected.
+//When the SNP process is lost the connection is closed by this thread between two batches, see waitNetwork().
+void* snp_delivery(void* arg) {
+    snp_pkt_t* pkts[OVERLAY_DELIVERY_BATCH];
+    while (1){
+        int pktNum = pktqueue_peek(deliveryq, pkts, OVERLAY_DELIVERY_BATCH);
+        pthread_mutex_lock(&snp_mutex);
+        if (snp_closing){
+            frame_release(network_conn);
+            close(network_conn);
+            network_conn = -1;
+            snp_closing = 0;
+            pthread_cond_broadcast(&snp_closed);
+        }
+        int conn = network_conn;
+        pthread_mutex_unlock(&snp_mutex);
+        if (conn != -1 && pktNum > 0 && forwardpktToSNP_batch(pkts, pktNum, conn) > 0){
+            LOG_DEBUG("Overlay: forward %d snp_pkt_t packets to local SNP!\n", pktNum);
+        }
+        pktqueue_release(deliveryq, pktNum);
+    }
     
-    // terminate this thread
-    pthread_detach(pthread_self());
     pthread_exit(0);
 }
 
-//This function opens a TCP port on OVERLAY_PORT, and waits for the incoming connection from local SNP process. After the local SNP process is connected, this function keeps getting sendpkt_arg_ts from SNP process, and sends the packets to the next hop in the overlay network. If the next hop's nodeID is BROADCAST_NODEID, the packet should be sent to all the neighboring nodes.
+//This function opens a TCP port on OVERLAY_PORT (or the one set in the instance configuration), and waits for the incoming connection from local SNP process. After the local SNP process is connected, this function keeps getting sendpkt_arg_ts from SNP process, and sends the packets to the next hop in the overlay network. If the next hop's nodeID is BROADCAST_NODEID, the packet should be sent to all the neighboring nodes.
 void waitNetwork() {
     //put your code here
-    int sockfd;
-    // create a new socket
-    if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-        perror("socket creation error\n");
-        exit(1);
-    }
-    
-    struct sockaddr_in server_addr, client_addr;
-    /* Prepare the socket address structure of the server */
-    server_addr.sin_family = AF_INET;       // host byte order
-    server_addr.sin_port = htons(OVERLAY_PORT);   // short, network byte order
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY); // automatically fill with my IP address "localhost"
-    memset(&(server_addr.sin_zero), '\0', 8); // zero the rest of the struct
-    
-    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(struct sockaddr)) == -1) {
-        perror("bind error\n");
+    int sockfd = ipc_listen(config_getOverlayPort());
+    if (sockfd < 0) {
         exit(1);
     }
     
-    if (listen(sockfd, 1) == -1) {
-        perror("listen error\n");
-        exit(1);
-    }
-    
-    socklen_t sin_size;
-    sin_size = sizeof(struct sockaddr_in);
-    
-    
     // create connection with local SNP process
     
     while (1){
-        if ((network_conn = accept(sockfd, (struct sockaddr *)&(client_addr), &sin_size)) == -1) {
-            perror("accept error\n");
+        int conn;
+        if ((conn = ipc_accept(sockfd)) == -1) {
             exit(1);
         }
+        pthread_mutex_lock(&snp_mutex);
+        network_conn = conn;
+        pthread_mutex_unlock(&snp_mutex);
         
-        printf("connected to local SNP!\n");
+        LOG_INFO("connected to local SNP!\n");
+        // the new SNP process starts from the costs in the topology, the measured costs and the down links are reported again
+        for (int i = 0; i < topology_getNbrNum(); i++){
+            __atomic_store_n(&nt[i].cost, nt[i].baseCost, __ATOMIC_RELAXED);
+        }
         
         snp_pkt_t *pkt = (snp_pkt_t *)malloc(sizeof(snp_pkt_t));
         int *nextNode = (int *)malloc(sizeof(int));
         int nbrNum = topology_getNbrNum();
+        // with the drop policy a neighbor whose send queue is full doesn't hold up the SNP data packets to the others,
+        // the route updates and link states never wait, they use the reserved end of the send buffer
+        int dataWait = config_getQueuePolicy() == CONFIG_QUEUE_BLOCK;
         
         while (1){
             // getting packets from SNP process
             
-            if (getpktToSend(pkt, nextNode, network_conn) < 0){
-                printf("lose connection with local SNP!\n");
+            if (getpktToSend(pkt, nextNode, conn) < 0){
+                LOG_ERROR("lose connection with local SNP!\n");
                 break;
             }
             
-            printf("Overlay: get a packet from SNP process! next hop is node %d!\n", *nextNode);
+            LOG_DEBUG("Overlay: get a packet from SNP process! next hop is node %d!\n", *nextNode);
+            int wait = pkt->header.type == SNP && dataWait;
             
             // send packets to the next hop in the overlay network
             if ((*nextNode) == BROADCAST_NODEID){
@@ -221,22 +871,30 @@ void waitNetwork() {
                     if (nt[i].conn == -1){
                         continue;
                     }
-                    sendpkt(pkt, nt[i].conn);
-                    printf("Overlay: send a packet to node %d!\n", nt[i].nodeID);
+                    nbr_sendpkt(i, pkt, wait);
+                    LOG_DEBUG("Overlay: send a packet to node %d!\n", nt[i].nodeID);
                 }
             }
             else {
                 for (int i = 0; i < nbrNum; i++){
                     if (nt[i].nodeID == (*nextNode)){
-                        sendpkt(pkt, nt[i].conn);
-                        printf("Overlay: send a packet to node %d!\n", nt[i].nodeID);
+                        nbr_sendpkt(i, pkt, wait);
+                        LOG_DEBUG("Overlay: send a packet to node %d!\n", nt[i].nodeID);
                         break;
                     }
                 }
             }
         }
         
-        close(network_conn);
+        // the delivery thread may be writing a batch to the connection, it closes the connection once the batch is written
+        // and drops the packets while no SNP process is connected
+        pthread_mutex_lock(&snp_mutex);
+        snp_closing = 1;
+        pktqueue_wake(deliveryq);
+        while (network_conn != -1){
+            pthread_cond_wait(&snp_closed, &snp_mutex);
+        }
+        pthread_mutex_unlock(&snp_mutex);
         free(pkt);
         free(nextNode);
     }
@@ -244,37 +902,96 @@ void waitNetwork() {
 
 //this function stops the overlay
 //it closes all the connections and frees all the dynamically allocated memory
-//it is called when receiving a signal SIGINT
+//it is called by the thread that waits for the signal SIGINT
 void overlay_stop() {
     //put your code here
-    close(network_conn);
+    // the connection to the SNP process belongs to the delivery thread, which may be writing to it, it is closed by exit()
+    for (int i = 0; i < topology_getNbrNum(); i++){
+        LOG_INFO("Overlay: send queue to node %d: %llu packets, %llu dropped, %llu waited, max %d bytes\n",
+                 nt[i].nodeID, nt[i].queuedPkts, nt[i].droppedPkts, nt[i].waitedPkts, nt[i].maxDepth);
+    }
     nt_destroy(nt);
-    printf("overlay is shutting down...\n");
+    LOG_INFO("overlay is shutting down...\n");
     exit(0);
 }
 
-int main() {
+//SIGINT, which is blocked in all the threads and taken by overlay_waitstop()
+static sigset_t stop_sigs;
+
+//This thread waits for SIGINT and stops the overlay. overlay_stop() runs in this thread and not in a signal handler,
+//so it can log and exit even if the signal comes while another thread holds a lock of the logging facility.
+static void* overlay_waitstop(void* arg) {
+    int sig;
+    while (sigwait(&stop_sigs, &sig) != 0 || sig != SIGINT);
+    overlay_stop();
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+	//block SIGINT before any thread is started, so that all the threads inherit the mask
+	sigemptyset(&stop_sigs);
+	sigaddset(&stop_sigs, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &stop_sigs, NULL);
+
+	log_init();
+	config_init(argc, argv);
+
 	//start overlay initialization
-	printf("Overlay: Node %d initializing...\n",topology_getMyNodeID());	
+	LOG_INFO("Overlay: Node %d initializing...\n",topology_getMyNodeID());	
 
 	//create a neighbor table
 	nt = nt_create();
 	//initialize network_conn to -1, means no SNP process is connected yet
 	network_conn = -1;
 	
-	//register a signal handler which is sued to terminate the process
-	signal(SIGINT, overlay_stop);
+	//start the thread which is used to terminate the process on SIGINT
+	pthread_t stop_thread;
+	pthread_create(&stop_thread,NULL,overlay_waitstop,(void*)0);
+	//a lost connection is seen by the reactors, not by a signal
+	signal(SIGPIPE, SIG_IGN);
 
 	//print out all the neighbors
 	int nbrNum = topology_getNbrNum();
 	int i;
 	for(i=0;i<nbrNum;i++) {
-		printf("Overlay: neighbor %d:%d\n",i+1,nt[i].nodeID);
+		LOG_INFO("Overlay: neighbor %d:%d\n",i+1,nt[i].nodeID);
+	}
+
+	//start the reactor threads, one per CPU but no more than the neighbors, and spread the neighbors over them
+	long cpuNum = sysconf(_SC_NPROCESSORS_ONLN);
+	reactorNum = cpuNum < OVERLAY_MAX_REACTORS ? (int)cpuNum : OVERLAY_MAX_REACTORS;
+	if (reactorNum > nbrNum) {
+		reactorNum = nbrNum;
+	}
+	if (reactorNum < 1) {
+		reactorNum = 1;
+	}
+	reactors = (reactor_t*)malloc(sizeof(reactor_t) * reactorNum);
+	for(i=0;i<nbrNum;i++) {
+		nt[i].reactor = i % reactorNum;
+	}
+	for(i=0;i<reactorNum;i++) {
+		if ((reactors[i].epfd = epoll_create1(0)) < 0) {
+			perror("epoll_create error\n");
+			exit(1);
+		}
+		reactors[i].again = (int*)malloc(sizeof(int) * (nbrNum + 1));
+		reactors[i].againNum = 0;
+	}
+	//start the thread that delivers the received packets to the SNP process
+	deliveryq = pktqueue_create(OVERLAY_DELIVERY_SLOTS);
+	pthread_t delivery_thread;
+	pthread_create(&delivery_thread,NULL,snp_delivery,(void*)0);
+
+	for(i=0;i<reactorNum;i++) {
+		pthread_t reactor_thread;
+		pthread_create(&reactor_thread,NULL,nbr_reactor,(void*)(long)i);
 	}
 
-	//start the waitNbrs thread to wait for incoming connections from neighbors with larger node IDs
-	pthread_t waitNbrs_thread;
-	pthread_create(&waitNbrs_thread,NULL,waitNbrs,(void*)0);
+	//open the port for the incoming connections from neighbors with larger node IDs
+	if (listenNbrs() < 0) {
+		exit(1);
+	}
 
 	//wait for other nodes to start
 	sleep(OVERLAY_START_DELAY);
@@ -282,20 +999,13 @@ int main() {
 	//connect to neighbors with smaller node IDs
 	connectNbrs();
 
-	//wait for waitNbrs thread to return
-	pthread_join(waitNbrs_thread,NULL);	
-
-	//at this point, all connections to the neighbors are created
+	//the links that are not connected yet count as down until they are
 	
-	//create threads listening to all the neighbors
-	for(i=0;i<nbrNum;i++) {
-		int* idx = (int*)malloc(sizeof(int));
-		*idx = i;
-		pthread_t nbr_listen_thread;
-		pthread_create(&nbr_listen_thread,NULL,listen_to_neighbor,(void*)idx);
-	}
-	printf("Overlay: node initialized...\n");
-	printf("Overlay: waiting for connection from SNP process...\n");
+	//start the thread that measures the links to the neighbors
+	pthread_t probe_thread;
+	pthread_create(&probe_thread,NULL,probe_daemon,(void*)0);
+	LOG_INFO("Overlay: node initialized...\n");
+	LOG_INFO("Overlay: waiting for connection from SNP process...\n");
 
 	//waiting for connection from  SNP process
 	waitNetwork();
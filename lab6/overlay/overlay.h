@@ -10,9 +10,9 @@
 #include "../common/pkt.h"
 #include "neighbortable.h"
 
-// This thread opens a TCP port on CONNECTION_PORT and waits for the incoming connection from all the neighbors that have a larger node ID than my nodeID,
-// After all the incoming connections are established, this thread terminates 
-void* waitNbrs();
+// This function opens a TCP port on CONNECTION_PORT for the incoming connections from the neighbors that have a larger node ID than my nodeID,
+// the connections are accepted by the reactors. Return 1 if the port is opened, otherwise return -1
+int listenNbrs();
 
 // This function connects to all the neighbors that have a smaller node ID than my nodeID
 // After all the outgoing connections are established, return 1, otherwise return -1
@@ -22,13 +22,22 @@ int connectNbrs();
 //This function opens a TCP port on OVERLAY_PORT, and waits for the incoming connection from local SNP process. After the local SNP process is connected, this function keeps getting send_arg_t structures from SNP process, and sends the packets to the next hop in the overlay network.
 void waitNetwork();
 
-//Each listen_to_neighbor thread keeps receiving packets from a neighbor. It handles the received packets by forwarding the packets to the SNP process.
-//all listen_to_neighbor threads are started after all the TCP connections to the neighbors are established 
-void* listen_to_neighbor(void* arg);
+//Each reactor thread serves the connections to a part of the neighbors with epoll. It keeps receiving packets from the neighbors and handles
+//the received packets by forwarding the packets to the SNP process, and writes out the packets waiting to be sent to the neighbors, see overlay.c.
+void* nbr_reactor(void* arg);
+
+//This thread sends a probe (heartbeat) to each neighbor every detection time / LINK_HEARTBEAT_MISSES, and reports
+//to the SNP process in a LINK_COST packet the links that went down or came back up, and every LINKCOST_INTERVAL milliseconds
+//the link costs computed from the smoothed RTT and load that changed by more than LINKCOST_HYSTERESIS percent, see overlay.c.
+void* probe_daemon(void* arg);
+
+//This thread is the only one that writes to the SNP process. It takes the packets the reactors and the probe thread put into
+//the delivery queue and forwards them to the SNP process in order, several of them with one system call.
+void* snp_delivery(void* arg);
 
 //this function stops the overlay
 //it closes all the connections and frees all the dynamically allocated memory
-//it is called when receiving a signal SIGINT
+//it is called by the thread that waits for the signal SIGINT
 void overlay_stop(); 
 
 #endif
@@ -0,0 +1,146 @@
+//FILE: overlay/pktqueue.c
+//
+//Description: this file implements the queue of packets that the ON process delivers to the SNP process
+//
+//Date: October 17, 2026
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pktqueue.h"
+
+pktqueue_t* pktqueue_create(int slotNum)
+{
+    pktqueue_t* q = (pktqueue_t *)malloc(sizeof(pktqueue_t));
+    q->slotNum = slotNum;
+    q->tail = 0;
+    q->head = 0;
+    q->sleeping = 0;
+    q->woken = 0;
+    q->waiting = 0;
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    q->slots = (pktqueue_slot_t *)malloc(sizeof(pktqueue_slot_t) * slotNum);
+    for (int i = 0; i < slotNum; i++){
+        q->slots[i].seq = i;
+    }
+    return q;
+}
+
+void pktqueue_destroy(pktqueue_t* q)
+{
+    pthread_mutex_destroy(&q->mutex);
+    pthread_cond_destroy(&q->cond);
+    pthread_cond_destroy(&q->notFull);
+    free(q->slots);
+    free(q);
+}
+
+int pktqueue_push(pktqueue_t* q, snp_pkt_t* pkt)
+{
+    unsigned int pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    pktqueue_slot_t* slot;
+    while (1){
+        slot = &q->slots[pos & (q->slotNum - 1)];
+        int diff = (int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0){
+            // the slot is free, take it unless another producer was faster
+            if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                break;
+            }
+        }
+        else if (diff < 0){
+            // the slot still holds the packet from one lap ago
+            return -1;
+        }
+        else {
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        }
+    }
+    memcpy(&slot->pkt, pkt, SNP_PKT_LEN(pkt));
+    // the packet is published before the consumer is checked, so either the consumer sees it or it is woken up
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST)){
+        pthread_mutex_lock(&q->mutex);
+        pthread_cond_signal(&q->cond);
+        pthread_mutex_unlock(&q->mutex);
+    }
+    return 1;
+}
+
+//return 1 if the slot at the tail of the queue still holds a packet
+static int pktqueue_full(pktqueue_t* q)
+{
+    unsigned int pos = __atomic_load_n(&q->tail, __ATOMIC_SEQ_CST);
+    return (int)(__atomic_load_n(&q->slots[pos & (q->slotNum - 1)].seq, __ATOMIC_SEQ_CST) - pos) < 0;
+}
+
+void pktqueue_pushwait(pktqueue_t* q, snp_pkt_t* pkt)
+{
+    while (pktqueue_push(q, pkt) < 0){
+        // check the queue again once the consumer can see that a producer waits,
+        // either the consumer sees the producer or the producer sees the free slot
+        pthread_mutex_lock(&q->mutex);
+        __atomic_add_fetch(&q->waiting, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (pktqueue_full(q)){
+            pthread_cond_wait(&q->notFull, &q->mutex);
+        }
+        __atomic_sub_fetch(&q->waiting, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&q->mutex);
+    }
+}
+
+int pktqueue_peek(pktqueue_t* q, snp_pkt_t** pkts, int max)
+{
+    int pktNum = 0;
+    while (1){
+        while (pktNum < max){
+            pktqueue_slot_t* slot = &q->slots[(q->head + pktNum) & (q->slotNum - 1)];
+            if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != q->head + pktNum + 1){
+                break;
+            }
+            pkts[pktNum++] = &slot->pkt;
+        }
+        if (__atomic_exchange_n(&q->woken, 0, __ATOMIC_SEQ_CST) || pktNum > 0){
+            return pktNum;
+        }
+        // check the queue again once the producers can see that the consumer sleeps
+        pthread_mutex_lock(&q->mutex);
+        __atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+        pktqueue_slot_t* slot = &q->slots[q->head & (q->slotNum - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != q->head + 1 && !__atomic_load_n(&q->woken, __ATOMIC_SEQ_CST)){
+            pthread_cond_wait(&q->cond, &q->mutex);
+        }
+        __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&q->mutex);
+    }
+}
+
+void pktqueue_wake(pktqueue_t* q)
+{
+    // the flag is set before the consumer is checked, as a packet is published in pktqueue_push()
+    __atomic_store_n(&q->woken, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST)){
+        pthread_mutex_lock(&q->mutex);
+        pthread_cond_signal(&q->cond);
+        pthread_mutex_unlock(&q->mutex);
+    }
+}
+
+void pktqueue_release(pktqueue_t* q, int pktNum)
+{
+    for (int i = 0; i < pktNum; i++){
+        pktqueue_slot_t* slot = &q->slots[q->head & (q->slotNum - 1)];
+        __atomic_store_n(&slot->seq, q->head + q->slotNum, __ATOMIC_RELEASE);
+        q->head++;
+    }
+    // the slots are freed before the producers are checked, as a packet is published in pktqueue_push()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (pktNum > 0 && __atomic_load_n(&q->waiting, __ATOMIC_SEQ_CST)){
+        pthread_mutex_lock(&q->mutex);
+        pthread_cond_broadcast(&q->notFull);
+        pthread_mutex_unlock(&q->mutex);
+    }
+}
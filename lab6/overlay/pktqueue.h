@@ -0,0 +1,67 @@
+//FILE: overlay/pktqueue.h
+//
+//Description: this file defines the queue of packets that the ON process delivers to the SNP process
+//
+//The reactor threads and the probe thread put the packets for the SNP process into one queue, and a single
+//delivery thread takes them out in order and writes them to the SNP process in batches, see snp_delivery() in overlay.c.
+//The queue is a bounded lock-free multi-producer/single-consumer ring: a producer takes a slot with one atomic
+//compare-and-swap and copies its packet into it, the consumer reads the packets in place and frees the slots
+//once they are written out. The consumer sleeps while the queue is empty, a producer wakes it only when it sleeps.
+//A producer that can wait sleeps while the queue is full, the consumer wakes the producers only when some sleep.
+//
+//Date: October 17, 2026
+
+#ifndef PKTQUEUE_H
+#define PKTQUEUE_H
+
+#include <pthread.h>
+#include "../common/pkt.h"
+
+//a slot of the queue
+//seq tells the state of the slot: the slot at position pos is free for the producer when seq is pos,
+//holds a packet for the consumer when seq is pos + 1, and is free again for position pos + slotNum after the consumer releases it
+typedef struct pktqueue_slot {
+	unsigned int seq;
+	snp_pkt_t pkt;
+} pktqueue_slot_t;
+
+typedef struct pktqueue {
+	int slotNum;			//number of slots, a power of two
+	unsigned int tail;		//next position taken by a producer
+	unsigned int head;		//next position read by the consumer, only written by the consumer
+	int sleeping;			//set while the consumer waits for a packet
+	int woken;			//set by pktqueue_wake() until the consumer returns from pktqueue_peek()
+	int waiting;			//number of producers waiting for a free slot
+	pthread_mutex_t mutex;		//only used to put the consumer and the producers to sleep and wake them up
+	pthread_cond_t cond;		//signaled when a packet is queued for the consumer
+	pthread_cond_t notFull;		//broadcast when slots are freed for the producers
+	pktqueue_slot_t* slots;
+} pktqueue_t;
+
+//This function creates a queue with slotNum slots dynamically, slotNum must be a power of two.
+pktqueue_t* pktqueue_create(int slotNum);
+
+//This function destroys a queue. It frees all the dynamically allocated memory for the queue.
+void pktqueue_destroy(pktqueue_t* q);
+
+//This function copies the packet pkt into the queue, it can be called by any number of threads.
+//Return 1 if the packet is queued, or -1 if the queue is full.
+int pktqueue_push(pktqueue_t* q, snp_pkt_t* pkt);
+
+//This function copies the packet pkt into the queue as pktqueue_push(), and sleeps while the queue is full.
+void pktqueue_pushwait(pktqueue_t* q, snp_pkt_t* pkt);
+
+//This function waits until the queue holds a packet or the consumer is woken up with pktqueue_wake(), and sets pkts
+//to the packets at the head of the queue in order, at most max of them. The packets stay in the queue until they are
+//released with pktqueue_release(). It is only called by the consumer thread.
+//Return the number of packets, 0 if the consumer is woken up while the queue is empty.
+int pktqueue_peek(pktqueue_t* q, snp_pkt_t** pkts, int max);
+
+//This function makes the consumer return from pktqueue_peek() even if the queue is empty, it can be called by any thread.
+void pktqueue_wake(pktqueue_t* q);
+
+//This function removes the pktNum packets at the head of the queue, it is called by the consumer thread
+//once it is done with the packets returned by pktqueue_peek().
+void pktqueue_release(pktqueue_t* q, int pktNum);
+
+#endif
@@ -19,6 +19,9 @@
 #include <stdio.h>
 #include <time.h>
 #include "../common/constants.h"
+#include "../common/ipc.h"
+#include "../common/log.h"
+#include "../common/config.h"
 #include "srt_server.h"
 
 //Two connection are created. One uses client port CLIENTPORT1 and server port SVRPORT1. The other uses client port CLIENTPORT2 and server port SVRPORT2.
@@ -29,31 +32,22 @@
 //After the strings are received, the server waits WAITTIME seconds, and then closes the connections
 #define WAITTIME 15
 
-//This function connects to the local SNP process on port NETWORK_PORT. If the TCP connection fails, return -1. The TCP socket desciptor returned will be used by SRT to send segments.
+//This function connects to the local SNP process on port NETWORK_PORT (or the one set in the instance configuration). If the TCP connection fails, return -1. The TCP socket desciptor returned will be used by SRT to send segments.
 int connectToNetwork() {
-	struct sockaddr_in servaddr;
-	
-	servaddr.sin_family = AF_INET;	
-	servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-	servaddr.sin_port = htons(NETWORK_PORT);
-
-	int network_conn = socket(AF_INET,SOCK_STREAM,0);  
-	if(network_conn<0)
-		return -1;
-	if(connect(network_conn, (struct sockaddr*)&servaddr, sizeof(servaddr))!=0) 
-		return -1;
-
-	//succefully connected
-	return network_conn;
+	return ipc_connect(config_getNetworkPort());
 }
 
 //This function is used to disconnect from the local SNP process by closing the TCP connection. 
 void disconnectToNetwork(int network_conn) {
+	frame_release(network_conn);
 	close(network_conn);
 }
 
 
-int main() {
+int main(int argc, char *argv[]) {
+	log_init();
+	config_init(argc, argv);
+
 	//random seed for segment loss
 	srand(time(NULL));
 
@@ -16,6 +16,7 @@
 #include "srt_server.h"
 #include "../topology/topology.h"
 #include "../common/constants.h"
+#include "../common/log.h"
 
 
 //declare tcbtable as global variable
@@ -257,7 +258,7 @@ void* seghandler(void* arg) {
 		//find the tcb to handle the segment
 		my_servertcb = tcbtable_gettcbFromPort(segBuf.header.dest_port);
 		if(!my_servertcb) {
-			printf("SERVER: NO PORT FOR RECEIVED SEGMENT\n");
+			LOG_WARN("SERVER: NO PORT FOR RECEIVED SEGMENT\n");
 			continue;
 		}
 		
@@ -269,22 +270,22 @@ void* seghandler(void* arg) {
 				//waiting for SYN segment from client
 				if(segBuf.header.type==SYN) {
 					// SYN received
-					printf("SERVER: SYN RECEIVED\n");
+					LOG_INFO("SERVER: SYN RECEIVED\n");
 					//update servertcb and send SYNACK back
 					my_servertcb->client_nodeID = src_nodeID;
 					my_servertcb->client_portNum = segBuf.header.src_port;
 					syn_received(my_servertcb,&segBuf);
 					//state transition
 					my_servertcb->state=CONNECTED;
-					printf("SERVER: CONNECTED\n");
+					LOG_INFO("SERVER: CONNECTED\n");
 				}
 				else
-					printf("SERVER: IN LISTENING, NON SYN SEG RECEIVED\n");
+					LOG_WARN("SERVER: IN LISTENING, NON SYN SEG RECEIVED\n");
 				break;
 			case CONNECTED:	
 				if(segBuf.header.type==SYN&&my_servertcb->client_portNum==segBuf.header.src_port&&my_servertcb->client_nodeID==src_nodeID) {
 					// SYN received
-					printf("SERVER: DUPLICATE SYN RECEIVED\n");
+					LOG_INFO("SERVER: DUPLICATE SYN RECEIVED\n");
 					//update servertcb
 					syn_received(my_servertcb,&segBuf);
 				}
@@ -293,9 +294,9 @@ void* seghandler(void* arg) {
 				}
 				else if(segBuf.header.type==FIN&&my_servertcb->client_portNum==segBuf.header.src_port&&my_servertcb->client_nodeID==src_nodeID) {
 					//state transition
-					printf("SERVER: FIN RECEIVED\n");
+					LOG_INFO("SERVER: FIN RECEIVED\n");
 		 			my_servertcb->state = CLOSEWAIT;	
-					printf("SERVER: CLOSEWAIT\n");
+					LOG_INFO("SERVER: CLOSEWAIT\n");
 					//start a closewait timer
 					pthread_t cwtimer;
 					pthread_create(&cwtimer,NULL,closewait, (void*)my_servertcb);
@@ -305,12 +306,12 @@ void* seghandler(void* arg) {
 				break;
 			case CLOSEWAIT:
 				if(segBuf.header.type==FIN&&my_servertcb->client_portNum==segBuf.header.src_port&&my_servertcb->client_nodeID==src_nodeID) {
-					printf("SERVER: DUPLICATE FIN RECEIVED\n");
+					LOG_INFO("SERVER: DUPLICATE FIN RECEIVED\n");
 					//send FINACK back
 					fin_received(my_servertcb,&segBuf);
 				}
 				else
-					printf("SERVER: IN CLOSEWAIT, NON FIN SEG RECEIVED\n");
+					LOG_WARN("SERVER: IN CLOSEWAIT, NON FIN SEG RECEIVED\n");
 				break;
 		}
 	}
@@ -338,7 +339,7 @@ void* closewait(void* servertcb) {
 	my_servertcb->usedBufLen= 0;
 	pthread_mutex_unlock(my_servertcb->bufMutex);
 	my_servertcb->state = CLOSED;
-	printf("SERVER: CLOSED\n");
+	LOG_INFO("SERVER: CLOSED\n");
 	pthread_exit(NULL);
 }
 
@@ -355,7 +356,15 @@ void syn_received(svr_tcb_t* svrtcb, seg_t* syn) {
 	synack.header.dest_port = svrtcb->client_portNum;
 	synack.header.length = 0;
 	snp_sendseg(network_conn,svrtcb->client_nodeID,&synack);
-	printf("SERVER: SYNACK SENT,%d,%d\n",synack.header.src_port,synack.header.dest_port);
+	//build the DATAACK for this connection once
+	bzero(&svrtcb->dataack,sizeof(svrtcb->dataack));
+	svrtcb->dataack.header.type = DATAACK;
+	svrtcb->dataack.header.src_port = svrtcb->svr_portNum;
+	svrtcb->dataack.header.dest_port = svrtcb->client_portNum;
+	svrtcb->dataack.header.ack_num = svrtcb->expect_seqNum;
+	svrtcb->dataack.header.length = 0;
+	svrtcb->dataack.header.checksum = checksum(&svrtcb->dataack);
+	LOG_INFO("SERVER: SYNACK SENT,%d,%d\n",synack.header.src_port,synack.header.dest_port);
 }
 
 //This function handles DATA segment
@@ -368,15 +377,10 @@ void data_received(svr_tcb_t* svrtcb, seg_t* data) {
 		if(savedata(svrtcb,data)<0)
 			return;
 	}
-	//send DATAACK back
-	seg_t dataack;
-	bzero(&dataack,sizeof(dataack));
-	dataack.header.type = DATAACK;
-	dataack.header.src_port = svrtcb->svr_portNum;
-	dataack.header.dest_port = svrtcb->client_portNum;
-	dataack.header.ack_num = svrtcb->expect_seqNum;
-	dataack.header.length = 0;
-	snp_sendseg(network_conn,svrtcb->client_nodeID,&dataack);
+	//send DATAACK back, only its ack number changes
+	seg_t* dataack = &svrtcb->dataack;
+	seg_setacknum(dataack, svrtcb->expect_seqNum);
+	snp_sendseg_batch(network_conn,svrtcb->client_nodeID,&dataack,1);
 }
 
 //This function handles FIN segment by sending a FINACK back 
@@ -388,7 +392,7 @@ void fin_received(svr_tcb_t* svrtcb, seg_t* fin) {
 	finack.header.dest_port = svrtcb->client_portNum;
 	finack.header.length = 0;
 	snp_sendseg(network_conn,svrtcb->client_nodeID,&finack);
-	printf("SERVER: FINACK SENT\n");
+	LOG_INFO("SERVER: FINACK SENT\n");
 }
 
 
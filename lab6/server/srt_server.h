@@ -34,6 +34,7 @@ typedef struct svr_tcb {
 	char* recvBuf;                  //a pointer pointing to the receive buffer
 	unsigned int  usedBufLen;       //size of the received data in receive buffer
 	pthread_mutex_t* bufMutex;      //a pointer pointing to the mutex which is used for receive buffer access
+	seg_t dataack;                  //DATAACK to the client with its checksum, only its ack number is rewritten for each DATA segment
 } svr_tcb_t;
 
 
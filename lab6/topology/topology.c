@@ -3,214 +3,342 @@
 //Description: this file implements some helper functions used to parse 
 //the topology file 
 //
+//The topology file (../topology/topology.dat, or the one set in the instance configuration, see common/config.h)
+//is parsed and all the host names are resolved only once, the first time
+//any of these functions is called. The result is kept in memory and never changes after that,
+//so all the functions below are cheap and can be called from any thread.
+//
 //Date: May 3,2010
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
 #include "topology.h"
 #include "../common/constants.h"
+#include "../common/config.h"
 
-//this function returns node ID of the given hostname
-//the node ID is an integer of the last 8 digit of the node's IP address
-//for example, a node with IP address 202.120.92.3 will have node ID 3
-//if the node ID can't be retrieved, return -1
-int topology_getNodeIDfromname(char* hostname) 
+//a node in the topology
+typedef struct topologynode {
+    int nodeID;
+    struct in_addr addr;
+    int port;                   //port the ON process of the node listens on for its neighbors
+    char name[HOSTNAME_LENGTH]; //the node as written in topology.dat
+    char host[HOSTNAME_LENGTH]; //the host part of name
+} topology_node_t;
+
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+static int myNodeID = -1;
+static int nodeNum = 0;
+static int nbrNum = 0;
+static topology_node_t* nodes = NULL;   //all the nodes, in the order they appear in topology.dat
+static int* nodeIDs = NULL;             //node IDs of all the nodes, same order as nodes
+static int* nbrIDs = NULL;              //node IDs of the neighbors, in the order they appear in topology.dat
+//direct links of each node (adjacency lists), the links of nodes[i] are adjNode[k] and adjCost[k] for k in [adjStart[i], adjStart[i + 1])
+//they take memory in proportion to the links, not to the square of the nodes
+static int* adjStart = NULL;
+static int* adjNode = NULL;             //index of the node at the other end of the link
+static unsigned int* adjCost = NULL;    //cost of the link
+
+//nodeID -> index in nodes, open addressing with linear probing
+//a slot holds the index + 1, or 0 if it is empty
+static int* indexMap = NULL;
+static int indexMapSize = 0;
+
+//return the slot of nodeID in indexMap, which is either the slot holding nodeID or the empty slot where it belongs
+static int topology_slot(int nodeID)
+{
+    unsigned int slot = ((unsigned int)nodeID * 2654435761u) & (indexMapSize - 1);
+    while (indexMap[slot] != 0 && nodes[indexMap[slot] - 1].nodeID != nodeID) {
+        slot = (slot + 1) & (indexMapSize - 1);
+    }
+    return slot;
+}
+
+//resolve hostname
+//return 1 and store its address in addr, or -1 if it can't be resolved
+static int topology_resolve(const char* hostname, struct in_addr* addr)
 {
     struct hostent *host;
     if ((host = gethostbyname(hostname)) == NULL){
         printf("Cannot resolve hostname, %s\n", hostname);
-        return - 1;
+        return -1;
     }
-    
-    struct in_addr addr;
-    memmove(&addr, host->h_addr_list[0], sizeof(struct in_addr));
-    char ip[16];
-    strcpy(ip, inet_ntoa(addr));
-    //printf("ip = %s\n", ip);
-    strtok(ip, ".");
-    strtok(NULL, ".");
-    strtok(NULL, ".");
-    char *node_id;
-    node_id = strtok(NULL, "\0");
-    //printf("node_id = %s\n", node_id);
-    int nodeID = atoi(node_id);
-    return nodeID;
+    memmove(addr, host->h_addr_list[0], sizeof(struct in_addr));
+    return 1;
 }
 
-//this function returns node ID from the given IP address
-//if the node ID can't be retrieved, return -1
-int topology_getNodeIDfromip(struct in_addr* addr)
+//parse a node written as [nodeID@]host[:port] in topology.dat
+//the node ID defaults to the last octet of the host's IP address
+//the port defaults to CONNECTION_PORT, or CONNECTION_PORT + nodeID if the node ID is given
+//return 1 if the node is parsed and its host is resolved, otherwise return -1
+static int topology_parsenode(const char* token, topology_node_t* node)
 {
-    char ip[16];
-    if (inet_ntoa(*addr) == NULL){
-        printf("Cannot resolve addr\n");
-        return - 1;
-    }
-    strcpy(ip, inet_ntoa(*addr));
-    //printf("ip = %s\n", ip);
-    strtok(ip, ".");
-    strtok(NULL, ".");
-    strtok(NULL, ".");
-    char *node_id;
-    node_id = strtok(NULL, "\0");
-    //printf("node_id = %s\n", node_id);
-    int nodeID = atoi(node_id);
-    return nodeID;
-}
+    const char* host = token;
+    const char* at = strchr(token, '@');
+    node->nodeID = -1;
+    if (at != NULL) {
+        char* end;
+        node->nodeID = (int)strtol(token, &end, 10);
+        if (end != at || at == token || node->nodeID < 0 || node->nodeID >= BROADCAST_NODEID) {
+            printf("Bad node ID in topology.dat: %s\n", token);
+            return -1;
+        }
+        host = at + 1;
+    }
 
-//this function returns my node ID
-//if my node ID can't be retrieved, return -1
-int topology_getMyNodeID()
-{
-    char hostname[HOSTNAME_LENGTH];
-    if (gethostname(hostname, sizeof(hostname)) < 0){
-        printf("Cannot get my hostname!\n");
+    strcpy(node->host, host);
+    node->port = node->nodeID < 0 ? CONNECTION_PORT : CONNECTION_PORT + node->nodeID;
+    char* colon = strchr(node->host, ':');
+    if (colon != NULL) {
+        char* end;
+        *colon = '\0';
+        node->port = (int)strtol(colon + 1, &end, 10);
+        if (*end != '\0' || end == colon + 1 || node->port <= 0 || node->port > 65535) {
+            printf("Bad port in topology.dat: %s\n", token);
+            return -1;
+        }
+    }
+
+    if (topology_resolve(node->host, &node->addr) < 0) {
         return -1;
     }
-    
-    return topology_getNodeIDfromname(hostname);
+    if (node->nodeID < 0) {
+        node->nodeID = topology_getNodeIDfromip(&node->addr);
+    }
+    strcpy(node->name, token);
+    return 1;
 }
 
-//this functions parses the topology information stored in topology.dat
-//returns the number of neighbors
-int topology_getNbrNum()
+//find the node written as token in topology.dat, add it if it is not there yet
+//return its index in nodes, or -1 if the node can't be parsed
+static int topology_addnode(const char* token, int* nodeCap)
 {
-    FILE *fp;
-    if ((fp = fopen("../topology/topology.dat", "r")) == NULL) {
-        printf("Cannot find topology.dat!\n");
+    for (int i = 0; i < nodeNum; i++) {
+        if (strcmp(nodes[i].name, token) == 0) {
+            return i;
+        }
+    }
+
+    topology_node_t node;
+    if (topology_parsenode(token, &node) < 0) {
         return -1;
     }
-    
+    // the same node may be written differently on different lines
+    for (int i = 0; i < nodeNum; i++) {
+        if (nodes[i].nodeID == node.nodeID) {
+            return i;
+        }
+    }
+    if (nodeNum == *nodeCap) {
+        *nodeCap = *nodeCap == 0 ? 16 : *nodeCap * 2;
+        nodes = (topology_node_t*)realloc(nodes, sizeof(topology_node_t) * (*nodeCap));
+    }
+    nodes[nodeNum] = node;
+    return nodeNum++;
+}
+
+//parse topology.dat and build the in-memory topology
+static void topology_load()
+{
     char hostname[HOSTNAME_LENGTH];
-    if (gethostname(hostname, sizeof(hostname)) < 0) {
-        printf("Cannot get my hostname!\n");
-        return -1;
+    struct in_addr addr;
+    // my node ID is set in the instance configuration, or taken from my IP address
+    myNodeID = config_getNodeID();
+    if (myNodeID < 0) {
+        if (gethostname(hostname, sizeof(hostname)) < 0) {
+            printf("Cannot get my hostname!\n");
+        }
+        else if (topology_resolve(hostname, &addr) > 0) {
+            myNodeID = topology_getNodeIDfromip(&addr);
+        }
     }
-    
+
+    FILE *fp;
+    if ((fp = fopen(config_getTopologyFile(), "r")) == NULL) {
+        printf("Cannot find %s!\n", config_getTopologyFile());
+        return;
+    }
+
+    // first pass: the nodes and the links, as indices into nodes
+    int nodeCap = 0;
+    int linkNum = 0;
+    int linkCap = 0;
+    int (*links)[3] = NULL;
     char line[256];
-    int count = 0;
     while (fgets(line, sizeof(line), fp)) {
-        //printf("%s\n", line);
-        if (strcmp(hostname, strtok(line, " ")) == 0){
-            count++;
+        char hostname_1[HOSTNAME_LENGTH];
+        char hostname_2[HOSTNAME_LENGTH];
+        unsigned int cost;
+        if (sscanf(line, "%255s %255s %u", hostname_1, hostname_2, &cost) != 3) {
+            continue;
+        }
+        int idx_1 = topology_addnode(hostname_1, &nodeCap);
+        int idx_2 = topology_addnode(hostname_2, &nodeCap);
+        if (idx_1 < 0 || idx_2 < 0) {
             continue;
         }
-        else if (strcmp(hostname, strtok(NULL, " ")) == 0){
-            count++;
+        if (linkNum == linkCap) {
+            linkCap = linkCap == 0 ? 16 : linkCap * 2;
+            links = realloc(links, sizeof(int[3]) * linkCap);
         }
+        links[linkNum][0] = idx_1;
+        links[linkNum][1] = idx_2;
+        links[linkNum][2] = cost;
+        linkNum++;
     }
-    
     fclose(fp);
-    //printf("count = %d\n", count);
-    return count;
+
+    if (nodeNum == 0) {
+        printf("0 hostname in topolody.dat!\n");
+    }
+
+    // node IDs and the nodeID -> index map
+    nodeIDs = (int*)malloc(sizeof(int) * (nodeNum + 1));
+    indexMapSize = 16;
+    while (indexMapSize < nodeNum * 2) {
+        indexMapSize *= 2;
+    }
+    indexMap = (int*)calloc(indexMapSize, sizeof(int));
+    for (int i = 0; i < nodeNum; i++) {
+        nodeIDs[i] = nodes[i].nodeID;
+        int slot = topology_slot(nodes[i].nodeID);
+        if (indexMap[slot] == 0) {
+            indexMap[slot] = i + 1;
+        }
+    }
+
+    // adjacency lists, each link is listed at both of its ends
+    adjStart = (int*)calloc(nodeNum + 1, sizeof(int));
+    adjNode = (int*)malloc(sizeof(int) * (2 * linkNum + 1));
+    adjCost = (unsigned int*)malloc(sizeof(unsigned int) * (2 * linkNum + 1));
+    for (int i = 0; i < linkNum; i++) {
+        adjStart[links[i][0] + 1]++;
+        adjStart[links[i][1] + 1]++;
+    }
+    for (int i = 0; i < nodeNum; i++) {
+        adjStart[i + 1] += adjStart[i];
+    }
+    int* adjFill = (int*)malloc(sizeof(int) * (nodeNum + 1));
+    memcpy(adjFill, adjStart, sizeof(int) * (nodeNum + 1));
+    for (int i = 0; i < linkNum; i++) {
+        int idx_1 = links[i][0];
+        int idx_2 = links[i][1];
+        adjNode[adjFill[idx_1]] = idx_2;
+        adjCost[adjFill[idx_1]++] = links[i][2];
+        adjNode[adjFill[idx_2]] = idx_1;
+        adjCost[adjFill[idx_2]++] = links[i][2];
+    }
+    free(adjFill);
+
+    // the neighbors of this node
+    nbrIDs = (int*)malloc(sizeof(int) * (linkNum + 1));
+    for (int i = 0; i < linkNum; i++) {
+        int idx_1 = links[i][0];
+        int idx_2 = links[i][1];
+        if (nodes[idx_1].nodeID == myNodeID) {
+            nbrIDs[nbrNum++] = nodes[idx_2].nodeID;
+        }
+        else if (nodes[idx_2].nodeID == myNodeID) {
+            nbrIDs[nbrNum++] = nodes[idx_1].nodeID;
+        }
+    }
+    free(links);
 }
 
-// This function is used to find out whether hostname is counted before.
-// Return 1: hostname is successfullly inserted into the name list
-//       -1: hostname already exists
-int insert_hostname(char ** hostname_list, char * hostname){
-    int i;
-    for (i = 0; i < MAX_NODE_NUM; i++){
-        if (hostname_list[i] == NULL){
-            break;
+//load the topology if it is not loaded yet
+static void topology_init()
+{
+    pthread_once(&topology_once, topology_load);
+}
+
+//this function returns node ID of the given hostname
+//the node ID is an integer of the last 8 digit of the node's IP address
+//for example, a node with IP address 202.120.92.3 will have node ID 3
+//if the node ID can't be retrieved, return -1
+int topology_getNodeIDfromname(char* hostname) 
+{
+    topology_init();
+    for (int i = 0; i < nodeNum; i++) {
+        if (strcmp(nodes[i].name, hostname) == 0) {
+            return nodes[i].nodeID;
         }
-        if (strcmp(hostname_list[i], hostname) == 0){   // hostname_list[i] and hostname are matched
-            break;
+    }
+
+    // a node ID
+    char* end;
+    long nodeID = strtol(hostname, &end, 10);
+    if (end != hostname && *end == '\0' && nodeID >= 0 && nodeID < BROADCAST_NODEID
+        && topology_getNodeIndex((int)nodeID) >= 0) {
+        return (int)nodeID;
+    }
+
+    // a host that has only one node
+    int found = -1;
+    for (int i = 0; i < nodeNum; i++) {
+        if (strcmp(nodes[i].host, hostname) == 0) {
+            if (found >= 0) {
+                printf("More than one node on %s, use the node ID\n", hostname);
+                return -1;
+            }
+            found = nodes[i].nodeID;
         }
     }
-    if (i < MAX_NODE_NUM && hostname_list[i] == NULL){
-        hostname_list[i] = (char *)malloc(HOSTNAME_LENGTH);
-        strcpy(hostname_list[i], hostname);
-        //printf("Now adding %s to hostname_list\n", hostname);
-        return 1;
+    if (found >= 0) {
+        return found;
     }
-    return -1;
+
+    // not in the topology, ask DNS
+    struct in_addr addr;
+    if (topology_resolve(hostname, &addr) < 0) {
+        return -1;
+    }
+    return topology_getNodeIDfromip(&addr);
+}
+
+//this function returns node ID from the given IP address
+//if the node ID can't be retrieved, return -1
+int topology_getNodeIDfromip(struct in_addr* addr)
+{
+    // the node ID is the last octet of the IP address
+    return ntohl(addr->s_addr) & 0xff;
+}
+
+//this function returns my node ID
+//if my node ID can't be retrieved, return -1
+int topology_getMyNodeID()
+{
+    topology_init();
+    return myNodeID;
+}
+
+//this functions parses the topology information stored in topology.dat
+//returns the number of neighbors
+int topology_getNbrNum()
+{
+    topology_init();
+    return nbrNum;
 }
 
 //this functions parses the topology information stored in topology.dat
 //returns the number of total nodes in the overlay 
 int topology_getNodeNum()
 { 
-    FILE *fp;
-    if ((fp = fopen("../topology/topology.dat", "r")) == NULL) {
-        printf("Cannot find topology.dat!\n");
-        return -1;
-    }
-    
-    char *hostname_list[MAX_NODE_NUM];
-    char line[256];
-    int count = 0;
-    
-    memset(hostname_list, 0, sizeof(hostname_list));
-    while (fgets(line, sizeof(line), fp)) {
-        char *temp;
-        temp = strtok(line, " ");
-        if (insert_hostname(hostname_list, temp) > 0){
-            count++;
-        }
-        
-        temp = strtok(NULL, " ");
-        if (insert_hostname(hostname_list, temp) > 0){
-            count++;
-        }
-    }
-    
-    for (int i = 0; i < count; i++){
-        free(hostname_list[i]);
-        hostname_list[i] = NULL;
-    }
-    
-    //printf("NodeNum = %d\n", count);
-    fclose(fp);
-    
-    return count;
+    topology_init();
+    return nodeNum;
 }
 
 //this functions parses the topology information stored in topology.dat
 //returns a dynamically allocated array which contains all the nodes' IDs in the overlay network  
 int* topology_getNodeArray()
 {
-    FILE *fp;
-    if ((fp = fopen("../topology/topology.dat", "r")) == NULL) {
-        printf("Cannot find topology.dat!\n");
+    topology_init();
+    if (nodeNum == 0) {
         return NULL;
     }
-    
-    char *hostname_list[MAX_NODE_NUM];
-    char line[256];
-    int count = 0;
-    
-    // get hostname_list from topology.dat
-    memset(hostname_list, 0, sizeof(hostname_list));
-    while (fgets(line, sizeof(line), fp)) {
-        char *temp;
-        temp = strtok(line, " ");
-        if (insert_hostname(hostname_list, temp) > 0){
-            count++;
-        }
-        
-        temp = strtok(NULL, " ");
-        if (insert_hostname(hostname_list, temp) > 0){
-            count++;
-        }
-    }
-    
-    if (count == 0){
-        printf("0 hostname in topolody.dat!\n");
-        return NULL;
-    }
-    
-    // create a dynamically allocated array
-    int * nodeID_list = (int *)malloc(sizeof(int) * count);
-    
-    // map hostname to nodeID and save it into nodeID_list
-    for (int i = 0; i < count; i++) {
-        int nodeID = topology_getNodeIDfromname(hostname_list[i]);
-        nodeID_list[i] = nodeID;
-        free(hostname_list[i]);
-        hostname_list[i] = NULL;
-    }
-    
-    //printf("NodeNum = %d\n", count);
-    fclose(fp);
+    int* nodeID_list = (int *)malloc(sizeof(int) * nodeNum);
+    memcpy(nodeID_list, nodeIDs, sizeof(int) * nodeNum);
     return nodeID_list;
 }
 
@@ -218,53 +346,9 @@ int* topology_getNodeArray()
 //returns a dynamically allocated array which contains all the neighbors'IDs  
 int* topology_getNbrArray()
 {
-    FILE *fp;
-    if ((fp = fopen("../topology/topology.dat", "r")) == NULL) {
-        printf("Cannot find topology.dat!\n");
-        return NULL;
-    }
-    
-    char my_hostname[HOSTNAME_LENGTH];
-    if (gethostname(my_hostname, sizeof(my_hostname)) < 0) {
-        printf("Cannot get my hostname!\n");
-        return NULL;
-    }
-    
-    char *nbr_name_list[MAX_NODE_NUM];
-    memset(nbr_name_list, 0, sizeof(nbr_name_list));
-    
-    char line[256];
-    int count = 0;
-    while (fgets(line, sizeof(line), fp)) {
-        // parse 1st hostname in this line
-        char * temp = strtok(line, " ");
-        if (strcmp(my_hostname, temp) == 0){
-            nbr_name_list[count] = (char *)malloc(HOSTNAME_LENGTH);
-            strcpy(nbr_name_list[count], strtok(NULL, " "));
-            count++;
-            continue;
-        }
-        // parse 2nd hostname in this line
-        else if (strcmp(my_hostname, strtok(NULL, " ")) == 0){
-            nbr_name_list[count] = (char *)malloc(HOSTNAME_LENGTH);
-            strcpy(nbr_name_list[count], temp);
-            count++;
-        }
-    }
-    
-    // create a dynamically allocated array
-    int * nodeID_list = (int *)malloc(sizeof(int) * count);
-    
-    // map hostname to nodeID and save it into nodeID_list
-    for (int i = 0; i < count; i++) {
-        int nodeID = topology_getNodeIDfromname(nbr_name_list[i]);
-        nodeID_list[i] = nodeID;
-        free(nbr_name_list[i]);
-        nbr_name_list[i] = NULL;
-    }
-    
-    fclose(fp);
-    //printf("count = %d\n", count);
+    topology_init();
+    int* nodeID_list = (int *)malloc(sizeof(int) * (nbrNum + 1));
+    memcpy(nodeID_list, nbrIDs, sizeof(int) * nbrNum);
     return nodeID_list;
 }
 
@@ -273,37 +357,56 @@ int* topology_getNbrArray()
 //if no direct link between the two given nodes, INFINITE_COST is returned
 unsigned int topology_getCost(int fromNodeID, int toNodeID)
 {
-    FILE *fp;
-    if ((fp = fopen("../topology/topology.dat", "r")) == NULL) {
-        printf("Cannot find topology.dat!\n");
-        return INFINITE_COST;
-    }
-    
     // special case!!
     if (fromNodeID == toNodeID){
         return 0;
     }
-    
-    char line[256];
-    while (fgets(line, sizeof(line), fp)) {
-        /*
-        char * hostname_1 = strtok(line, " ");
-        char * hostname_2 = strtok(NULL, " ");
-         */
-        char hostname_1[HOSTNAME_LENGTH];
-        char hostname_2[HOSTNAME_LENGTH];
-        char str_cost[5];
-        sscanf(line, "%s %s %s\n", hostname_1, hostname_2, str_cost);
-        
-        int nodeID_1 = topology_getNodeIDfromname(hostname_1);
-        int nodeID_2 = topology_getNodeIDfromname(hostname_2);
-        
-        if ((nodeID_1 == fromNodeID && nodeID_2 == toNodeID)||(nodeID_1 == toNodeID && nodeID_2 == fromNodeID)) {
-            //char * str_cost = strtok(NULL, "\0");
-            fclose(fp);
-            return atoi(str_cost);
+
+    int from = topology_getNodeIndex(fromNodeID);
+    int to = topology_getNodeIndex(toNodeID);
+    if (from < 0 || to < 0) {
+        return INFINITE_COST;
+    }
+    // a link given twice in topology.dat has the cost given last
+    unsigned int cost = INFINITE_COST;
+    for (int k = adjStart[from]; k < adjStart[from + 1]; k++) {
+        if (adjNode[k] == to) {
+            cost = adjCost[k];
         }
     }
-    fclose(fp);
-    return INFINITE_COST;
+    return cost;
+}
+
+//this function returns the index of the given node in the array returned by topology_getNodeArray()
+//if the node is not in the overlay, return -1
+int topology_getNodeIndex(int nodeID)
+{
+    topology_init();
+    if (indexMapSize == 0) {
+        return -1;
+    }
+    return indexMap[topology_slot(nodeID)] - 1;
+}
+
+//this function gets the IP address of the given node
+//return 1 and store the address in addr, or -1 if the node is not in the overlay
+int topology_getNodeIP(int nodeID, struct in_addr* addr)
+{
+    int idx = topology_getNodeIndex(nodeID);
+    if (idx < 0) {
+        return -1;
+    }
+    *addr = nodes[idx].addr;
+    return 1;
+}
+
+//this function returns the port the ON process of the given node listens on for its neighbors
+//if the node is not in the overlay, return -1
+int topology_getNodePort(int nodeID)
+{
+    int idx = topology_getNodeIndex(nodeID);
+    if (idx < 0) {
+        return -1;
+    }
+    return nodes[idx].port;
 }
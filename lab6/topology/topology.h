@@ -1,6 +1,14 @@
 //FILE: topology/topology.h
 //
 //Description: this file declares some help functions used to parse the topology file 
+//The topology file is parsed only once and kept in memory, the functions are cheap to call.
+//
+//Each line of the topology file is a link: "node node cost". A node is written as [nodeID@]host[:port].
+//The node ID defaults to the last octet of the host's IP address. The port is the one the ON process
+//of the node listens on for its neighbors, it defaults to CONNECTION_PORT, or CONNECTION_PORT + nodeID
+//if the node ID is given. So several nodes can run on one host, for example:
+//  1@localhost 2@localhost 3
+//  2@localhost 3@localhost:4000 1
 //
 //Date: April 29,2008
 
@@ -20,6 +28,7 @@
 //this function returns node ID of the given hostname
 //the node ID is an integer of the last 8 digit of the node's IP address
 //for example, a node with IP address 202.120.92.3 will have node ID 3
+//hostname can also be a node as written in the topology file, or a node ID
 //if the node ID can't be retrieved, return -1
 int topology_getNodeIDfromname(char* hostname); 
 
@@ -51,4 +60,16 @@ int* topology_getNbrArray();
 //returns the cost of the direct link between the two given nodes 
 //if no direct link between the two given nodes, INFINITE_COST is returned
 unsigned int topology_getCost(int fromNodeID, int toNodeID);
+
+//this function returns the index of the given node in the array returned by topology_getNodeArray()
+//if the node is not in the overlay, return -1
+int topology_getNodeIndex(int nodeID);
+
+//this function gets the IP address of the given node
+//return 1 and store the address in addr, or -1 if the node is not in the overlay
+int topology_getNodeIP(int nodeID, struct in_addr* addr);
+
+//this function returns the port the ON process of the given node listens on for its neighbors
+//if the node is not in the overlay, return -1
+int topology_getNodePort(int nodeID);
 #endif